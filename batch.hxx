@@ -0,0 +1,489 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "solver.hxx"
+#include "portfolio.hxx"
+#include "cube_and_conquer.hxx"
+#include "dimacs.hxx"
+#include "cnf.hxx"
+#include "rules.hxx"
+#include "heuristic.hxx"
+#include "dprintf.hxx"
+
+/// Solving list of instances in forked workers, several of them at once.
+/// Every worker has its own address space, so memory cap and peak memory are per instance,
+/// and worker which crashed or was killed doesn't take others down
+class Batch
+{
+public:
+
+    struct Limits
+    {
+        uint32_t jobs = 1; /// Instances solved at once
+        double seconds = 0; /// Timeout of every instance including parsing, 0 means no timeout
+        uint64_t memory_mb = 0; /// Address space cap of every instance, 0 means no cap
+    };
+
+    /// Result of one instance, wall time and peak memory are measured by parent, the rest by worker
+    struct Report
+    {
+        Solver::Status status = Solver::Status::UNKNOWN;
+        bool error = false; /// Instance couldn't be parsed or worker died without answer
+        bool timed_out = false;
+        bool memory_out = false; /// Worker reported bad_alloc
+        int32_t signal = 0; /// Signal which killed worker without answer, 0 if it exited
+        uint32_t variables = 0;
+        uint32_t clauses = 0;
+        double parse_seconds = 0;
+        double solve_seconds = 0;
+        double wall_seconds = 0;
+        double cpu_seconds = 0; /// User and system time, unlike wall time it doesn't depend on other instances running at once
+        uint64_t decisions = 0;
+        uint64_t propagations = 0;
+        uint64_t conflicts = 0;
+        uint64_t peak_memory_kb = 0;
+    };
+
+    Batch(Limits limits, Rule rules, Heuristic heuristic, uint32_t threads, int cube_depth); /// Threads and cube depth choose solver of every instance the way main does
+    Batch(Batch&) = delete;
+
+    bool Run(std::vector<std::string>& files, FILE* stats); /// Printing answers to stdout and reports to stats (if not null), returning false if some instance ended with ERROR or MEMOUT
+    static bool ReadList(const char filename[], std::vector<std::string>& files); /// Appending file names listed one per line, "-" is stdin
+
+    static void PrintModel(FILE* out, std::vector<Literal>& model); /// Printing model as "v ..." lines terminated by 0
+    static void PrintStats(FILE* out, const char filename[], Report& report); /// Printing report as one line JSON object
+    static double CpuSeconds(rusage& usage); /// User and system time from usage
+
+private:
+
+    static constexpr double KillGrace = 1; /// Seconds given to worker to report after timeout, then it is killed
+
+    struct Job
+    {
+        pid_t pid = -1;
+        int fd = -1; /// Read end of pipe from worker
+        std::string file;
+        std::string data; /// Report and model received so far
+        std::chrono::steady_clock::time_point start;
+        bool killed = false;
+    };
+
+    bool _spawn(const std::string& file, Job& job);
+    void _work(const std::string& file, int fd); /// Body of worker process, sending Report, model size and model to fd
+    Solver::Status _solve(CNF& cnf, Solver::Statistics& counters, std::vector<Literal>& model); /// Solving by single solver, portfolio or cube and conquer
+    bool _finish(Job& job, FILE* stats); /// Collecting worker and printing its result, returning false on ERROR or MEMOUT
+    static bool _write(int fd, const void* data, uintptr_t size);
+    static void _alarm(int signal);
+    static const char* _outcome(Report& report);
+
+    inline static std::atomic<bool> _timeout { false }; /// Raised by SIGALRM in worker
+
+    Limits _limits;
+    Rule _rules = Rule::NONE;
+    Heuristic _heuristic = Heuristic::FIRST_LITERAL;
+    uint32_t _threads = 1; /// Threads of every worker, 0 means all available cores
+    int _cube_depth = -1; /// Cube and conquer is used instead of portfolio if depth is set
+};
+
+Batch::Batch(Limits limits, Rule rules, Heuristic heuristic, uint32_t threads, int cube_depth) :
+    _limits(limits), _rules(rules), _heuristic(heuristic), _threads(threads), _cube_depth(cube_depth)
+{
+    if (_limits.jobs == 0)
+        _limits.jobs = 1;
+}
+
+bool Batch::ReadList(const char filename[], std::vector<std::string>& files)
+{
+    FILE* list = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (not list)
+    {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), list))
+    {
+        uintptr_t length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (length != 0)
+            files.push_back(line);
+    }
+
+    if (list != stdin)
+        fclose(list);
+    return true;
+}
+
+bool Batch::Run(std::vector<std::string>& files, FILE* stats)
+{
+    std::vector<Job> running;
+    std::vector<pollfd> polled;
+    uintptr_t next = 0;
+    bool ok = true;
+
+    while (next < files.size() or not running.empty())
+    {
+        while (next < files.size() and running.size() < _limits.jobs)
+        {
+            Job job;
+            if (not _spawn(files[next++], job))
+            {
+                ok = false;
+                continue;
+            }
+
+            running.push_back(job);
+            polled.push_back({ job.fd, POLLIN, 0 });
+        }
+
+        if (poll(polled.data(), polled.size(), 50) < 0 and errno != EINTR)
+        {
+            perror("poll");
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (uintptr_t idx = 0; idx < running.size(); )
+        {
+            Job& job = running[idx];
+
+            bool finished = false;
+            if (polled[idx].revents != 0)
+            {
+                char buffer[1 << 16];
+                ssize_t got = read(job.fd, buffer, sizeof(buffer));
+                if (got > 0)
+                    job.data.append(buffer, got);
+                else if (got == 0 or errno != EINTR)
+                    finished = true;
+            }
+
+            // Worker which doesn't react on its own timeout (e.g. still parsing) is killed
+            double elapsed = std::chrono::duration<double>(now - job.start).count();
+            if (not finished and not job.killed and _limits.seconds > 0 and elapsed > _limits.seconds + KillGrace)
+            {
+                dprintf("Killing worker %d solving %s\n", job.pid, job.file.c_str());
+                kill(job.pid, SIGKILL);
+                job.killed = true;
+            }
+
+            if (not finished)
+            {
+                idx++;
+                continue;
+            }
+
+            ok = _finish(job, stats) and ok;
+            running.erase(running.begin() + idx);
+            polled.erase(polled.begin() + idx);
+        }
+    }
+
+    return ok;
+}
+
+bool Batch::_spawn(const std::string& file, Job& job)
+{
+    // Decompressor started by worker must not inherit write end, parent would wait for its end otherwise
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+    {
+        perror("pipe");
+        return false;
+    }
+
+    // Buffered output would be printed by every worker otherwise
+    fflush(nullptr);
+
+    job.file = file;
+    job.start = std::chrono::steady_clock::now();
+    job.pid = fork();
+
+    if (job.pid < 0)
+    {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (job.pid == 0)
+    {
+        close(fds[0]);
+        _work(file, fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    job.fd = fds[0];
+    dprintf("Worker %d started on %s\n", job.pid, file.c_str());
+    return true;
+}
+
+void Batch::_work(const std::string& file, int fd)
+{
+    if (_limits.memory_mb > 0)
+    {
+        rlimit limit;
+        limit.rlim_cur = limit.rlim_max = _limits.memory_mb << 20;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+
+    if (_limits.seconds > 0)
+    {
+        signal(SIGALRM, _alarm);
+        itimerval timer {};
+        timer.it_value.tv_sec = (time_t) _limits.seconds;
+        timer.it_value.tv_usec = (suseconds_t) ((_limits.seconds - timer.it_value.tv_sec) * 1e6);
+        setitimer(ITIMER_REAL, &timer, nullptr);
+    }
+
+    Report report;
+    std::vector<Literal> model;
+    auto start = std::chrono::steady_clock::now();
+
+    try
+    {
+        DIMACS::ParseResult parsed;
+        CNF cnf = DIMACS::ReadFromFile(file.c_str(), &parsed);
+        auto parsed_at = std::chrono::steady_clock::now();
+        report.parse_seconds = std::chrono::duration<double>(parsed_at - start).count();
+
+        if (not parsed.ok)
+        {
+            fprintf(stderr, "%s:%lu:%lu: %s\n", file.c_str(), parsed.line, parsed.column, parsed.message.c_str());
+            report.error = true;
+        }
+        else
+        {
+            report.variables = cnf.VariablesCount();
+            report.clauses = cnf.ClausesCount();
+
+            Solver::Statistics counters;
+            report.status = _solve(cnf, counters, model);
+            report.solve_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed_at).count();
+
+            report.decisions = counters.decisions;
+            report.propagations = counters.propagations;
+            report.conflicts = counters.conflicts;
+        }
+    }
+    catch (std::bad_alloc&)
+    {
+        report.status = Solver::Status::UNKNOWN;
+        report.memory_out = true;
+        model.clear();
+    }
+
+    report.timed_out = report.status == Solver::Status::UNKNOWN and _timeout.load();
+
+    uint64_t model_size = report.status == Solver::Status::SAT ? model.size() : 0;
+    // If parent is gone, there is nobody to report to anyway
+    if (_write(fd, &report, sizeof(report)) and _write(fd, &model_size, sizeof(model_size)))
+        _write(fd, model.data(), model_size * sizeof(Literal));
+    close(fd);
+}
+
+Solver::Status Batch::_solve(CNF& cnf, Solver::Statistics& counters, std::vector<Literal>& model)
+{
+    // Parallel searches watch the flag from their own thread, so it is given only if it can be raised
+    const std::atomic<bool>* stop = _limits.seconds > 0 ? &_timeout : nullptr;
+    Solver::Status result = Solver::Status::UNKNOWN;
+
+    if (_cube_depth >= 0)
+    {
+        CubeAndConquer cube_and_conquer(_threads, _cube_depth, _rules, _heuristic);
+        cube_and_conquer.StopOn(stop);
+        result = cube_and_conquer.Solve(cnf);
+        counters = cube_and_conquer.Stats();
+        model.swap(cube_and_conquer.Model());
+    }
+    else if (_threads == 1)
+    {
+        Solver solver(_rules, _heuristic);
+        solver.StopOn(stop);
+        result = solver.Solve(cnf);
+        counters = solver.Stats();
+        model.swap(solver.Model());
+    }
+    else
+    {
+        Portfolio portfolio(_threads);
+        portfolio.StopOn(stop);
+        result = portfolio.Solve(cnf);
+        counters = portfolio.Stats();
+        model.swap(portfolio.Model());
+    }
+
+    return result;
+}
+
+bool Batch::_finish(Job& job, FILE* stats)
+{
+    close(job.fd);
+
+    int status = 0;
+    rusage usage {};
+    wait4(job.pid, &status, 0, &usage);
+
+    Report report;
+    std::vector<Literal> model;
+
+    uint64_t model_size = 0;
+    if (job.data.size() >= sizeof(report) + sizeof(model_size))
+    {
+        memcpy(&report, job.data.data(), sizeof(report));
+        memcpy(&model_size, job.data.data() + sizeof(report), sizeof(model_size));
+        if (job.data.size() == sizeof(report) + sizeof(model_size) + model_size * sizeof(Literal))
+        {
+            model.resize(model_size);
+            memcpy(model.data(), job.data.data() + sizeof(report) + sizeof(model_size), model_size * sizeof(Literal));
+        }
+        else
+            report.error = true;
+    }
+    else if (job.killed)
+        report.timed_out = true;
+    else
+    {
+        // Death on signal is a crash (e.g. SIGSEGV) even under memory cap, only bad_alloc caught by worker is MEMOUT
+        if (WIFSIGNALED(status))
+        {
+            report.signal = WTERMSIG(status);
+            fprintf(stderr, "%s: worker died on signal %d (%s)\n", job.file.c_str(), report.signal, strsignal(report.signal));
+        }
+        report.error = true;
+    }
+
+    report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.start).count();
+    report.cpu_seconds = CpuSeconds(usage);
+    report.peak_memory_kb = usage.ru_maxrss;
+
+    printf("c %s\n", job.file.c_str());
+    switch (report.error ? Solver::Status::UNKNOWN : report.status)
+    {
+        case Solver::Status::SAT:
+            printf("s SATISFIABLE\n");
+            PrintModel(stdout, model);
+            break;
+        case Solver::Status::UNSAT:
+            printf("s UNSATISFIABLE\n"); break;
+        default:
+            printf("s UNKNOWN\n");
+    }
+    fflush(stdout);
+
+    if (stats)
+    {
+        PrintStats(stats, job.file.c_str(), report);
+        fflush(stats);
+    }
+
+    // Timeout is an expected answer of batch, running out of memory means the cap is too low for the instance
+    return not report.error and not report.memory_out;
+}
+
+double Batch::CpuSeconds(rusage& usage)
+{
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void Batch::PrintModel(FILE* out, std::vector<Literal>& model)
+{
+    // Lines are kept shorter than 80 characters as competition format suggests
+    std::string line = "v";
+    char literal[16];
+
+    for (Literal value : model)
+    {
+        snprintf(literal, sizeof(literal), " %d", value);
+        if (line.size() + strlen(literal) >= 78)
+        {
+            fprintf(out, "%s\n", line.c_str());
+            line = "v";
+        }
+        line += literal;
+    }
+
+    fprintf(out, "%s 0\n", line.c_str());
+}
+
+void Batch::PrintStats(FILE* out, const char filename[], Report& report)
+{
+    std::string file;
+    for (const char* symbol = filename; *symbol != '\0'; symbol++)
+    {
+        if (*symbol == '"' or *symbol == '\\')
+            file += '\\';
+
+        if ((unsigned char) *symbol < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", *symbol);
+            file += escaped;
+        }
+        else
+            file += *symbol;
+    }
+
+    fprintf(out, "{\"file\": \"%s\", \"status\": \"%s\", \"variables\": %u, \"clauses\": %u, "
+                 "\"parse_seconds\": %.6f, \"solve_seconds\": %.6f, \"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, "
+                 "\"decisions\": %lu, \"propagations\": %lu, \"conflicts\": %lu, \"peak_memory_kb\": %lu, \"signal\": %d}\n",
+            file.c_str(), _outcome(report), report.variables, report.clauses,
+            report.parse_seconds, report.solve_seconds, report.wall_seconds, report.cpu_seconds,
+            report.decisions, report.propagations, report.conflicts, report.peak_memory_kb, report.signal);
+}
+
+const char* Batch::_outcome(Report& report)
+{
+    if (report.memory_out)
+        return "MEMOUT";
+    if (report.error)
+        return "ERROR";
+    if (report.timed_out)
+        return "TIMEOUT";
+
+    switch (report.status)
+    {
+        case Solver::Status::SAT: return "SAT";
+        case Solver::Status::UNSAT: return "UNSAT";
+        default: return "UNKNOWN";
+    }
+}
+
+bool Batch::_write(int fd, const void* data, uintptr_t size)
+{
+    const char* bytes = (const char*) data;
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 and errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+
+        bytes += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+void Batch::_alarm(int)
+{
+    _timeout.store(true);
+}
@@ -0,0 +1,140 @@
+from sys import argv, exit
+from os import makedirs, cpu_count, path
+from time import time
+from subprocess import run, PIPE
+from json import dumps, loads
+import random
+
+# Fixed suite of random 3-SAT instances: (name, variables, clauses to variables ratio, count).
+# Every instance is generated from its own fixed seed, so every run solves exactly the same formulas
+# and instances left from previous runs can be reused
+SUITE = [
+    ('uf100', 100, 4.26, 20),
+    ('uf150', 150, 4.26, 16),
+    ('uf200', 200, 4.26, 8),
+    ('easy20000', 20000, 3.0, 4),
+    ('wide100000', 100000, 2.0, 2),
+]
+
+SEED = 2024
+FOLDER = '/tmp/dpll_bench'
+BASELINE = 'bench_baseline.json' # Revision to compare with and its answers on the suite
+TOLERANCE = 0.15 # Throughput relative to baseline revision may drop by this share before bench fails
+ROUNDS = 2 # Both binaries solve the suite this many times by turns, the fastest time of every instance is taken
+
+def generate(filename, variables, ratio, rng):
+    clauses = int(variables * ratio)
+    lines = [f'p cnf {variables} {clauses}']
+    for _ in range(clauses):
+        picked = rng.sample(range(1, variables + 1), 3)
+        lines.append(' '.join(str(v if rng.random() < 0.5 else -v) for v in picked) + ' 0')
+
+    with open(filename, 'w') as file:
+        file.write('\n'.join(lines) + '\n')
+
+def suite():
+    makedirs(FOLDER, exist_ok=True)
+    files = []
+    for name, variables, ratio, count in SUITE:
+        for idx in range(count):
+            filename = f'{FOLDER}/{name}-{ratio}-{idx}.cnf'
+            if not path.exists(filename):
+                generate(filename, variables, ratio, random.Random(f'{SEED}-{name}-{ratio}-{idx}'))
+            files.append(filename)
+    return files
+
+def build(revision):
+    # Baseline revision is built from git archive, so working tree is never touched
+    folder = f'{FOLDER}/build-{revision[:12]}'
+    binary = f'{folder}/dpll'
+    if not path.exists(binary):
+        makedirs(folder, exist_ok=True)
+        archive = run(['git', 'archive', revision], stdout=PIPE, check=True).stdout
+        run(['tar', '-x', '-C', folder], input=archive, check=True)
+        run(['make', '-C', folder, 'dpll'], capture_output=True, check=True)
+    return binary
+
+def solve(binary, files, jobs):
+    stats_filename = f'{FOLDER}/stats.jsonl'
+    res = run([binary, '--batch', '-', '--jobs', str(jobs), '--stats', stats_filename],
+              input=''.join(f'{file}\n' for file in files), capture_output=True, text=True)
+    if res.returncode != 0:
+        print(f'{binary} failed:\n{res.stderr}')
+        exit(1)
+
+    with open(stats_filename) as stats_file:
+        return { item['file'].split('/')[-1]: item for item in map(loads, stats_file) }
+
+def summary(runs):
+    # CPU time doesn't depend on number of cores and on other processes, unlike wall time,
+    # the fastest of rounds is the least disturbed one
+    fastest = { test: min(stats[test]['cpu_seconds'] for stats in runs) for test in runs[0] }
+    cpu = sum(fastest.values())
+    return {
+        'solved': sum(item['status'] in ('SAT', 'UNSAT') for item in runs[0].values()),
+        'seconds': cpu,
+        'instances_per_second': len(fastest) / cpu,
+        'families': { name: sum(seconds for test, seconds in fastest.items() if test.startswith(name + '-')) for name, *_ in SUITE },
+        'peak_memory_kb': max(item['peak_memory_kb'] for item in runs[0].values()),
+        'answers': { test: runs[0][test]['status'] for test in sorted(runs[0]) },
+    }
+
+update = '--update' in argv[1:]
+jobs = cpu_count() or 1
+files = suite()
+
+if update:
+    revision = run(['git', 'rev-parse', 'HEAD'], stdout=PIPE, text=True, check=True).stdout.strip()
+    current = summary([solve(build(revision), files, jobs)])
+    with open(BASELINE, 'w') as baseline_file:
+        baseline_file.write(dumps({ 'revision': revision, 'answers': current['answers'] }, indent=2) + '\n')
+    print(f'Baseline revision {revision[:12]} solved {current["solved"]}/{len(files)} instances, written to {BASELINE}')
+    exit(0)
+
+with open(BASELINE) as baseline_file:
+    baseline = loads(baseline_file.read())
+
+baseline_binary = build(baseline['revision'])
+
+start = time()
+current_runs, baseline_runs = [], []
+for round_no in range(ROUNDS):
+    # Order is alternated, so slow periods of machine hit both binaries alike
+    order = [(current_runs, './dpll'), (baseline_runs, baseline_binary)]
+    for runs, binary in (order if round_no % 2 == 0 else order[::-1]):
+        runs.append(solve(binary, files, jobs))
+wall = time() - start
+
+current = summary(current_runs)
+reference = summary(baseline_runs)
+
+print(f'Solved {current["solved"]}/{len(files)} instances, {ROUNDS} rounds of both binaries took {wall:.2f} s with {jobs} jobs')
+print(f'{"":>24}  {"current":>10}  {"baseline " + baseline["revision"][:8]:>18}  {"change":>8}')
+
+def compare(name, now, then, unit):
+    change = (now - then) / then * 100 if then else 0
+    print(f'{name:>24}: {now:>10.3f}{unit}  {then:>17.3f}{unit}  {change:>+7.1f}%')
+
+compare('instances_per_second', current['instances_per_second'], reference['instances_per_second'], ' ')
+compare('cpu_seconds', current['seconds'], reference['seconds'], 's')
+for name in current['families']:
+    compare(name, current['families'][name], reference['families'][name], 's')
+compare('peak_memory_mb', current['peak_memory_kb'] / 1024, reference['peak_memory_kb'] / 1024, ' ')
+
+failed = False
+
+for test, answer in current['answers'].items():
+    expected = baseline['answers'].get(test)
+    if expected in ('SAT', 'UNSAT') and answer in ('SAT', 'UNSAT') and answer != expected:
+        print(f'Wrong answer on {test}: {answer} instead of {expected}')
+        failed = True
+
+if current['solved'] < reference['solved']:
+    print('Fewer instances are solved than by baseline revision')
+    failed = True
+
+if current['instances_per_second'] < reference['instances_per_second'] * (1 - TOLERANCE):
+    print(f'Throughput dropped by more than {TOLERANCE * 100:.0f}% against baseline revision')
+    failed = True
+
+exit(1 if failed else 0)
@@ -0,0 +1,86 @@
+#include "dimacs.hxx"
+#include "cnf.hxx"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Comparing load time of streaming DIMACS parser with the legacy line based one.
+// Usage: bench_dimacs [filename, ..], random 3-SAT instance is generated if no files provided
+
+static std::string GenerateInstance(uint32_t variables, uint32_t clauses)
+{
+    std::string filename = "/tmp/bench_dimacs.cnf";
+    FILE* file = fopen(filename.c_str(), "w");
+    if (not file)
+        return "";
+
+    srand(42);
+    fprintf(file, "c random 3-SAT instance for parser benchmark\np cnf %u %u\n", variables, clauses);
+    for (uint32_t clause = 0; clause < clauses; clause++)
+    {
+        for (int literal = 0; literal < 3; literal++)
+            fprintf(file, "%d ", (rand() % 2 ? -1 : 1) * (rand() % (int) variables + 1));
+        fprintf(file, "0\n");
+    }
+
+    fclose(file);
+    return filename;
+}
+
+template <class Reader>
+static double Measure(Reader reader, int repeats, CNF& result)
+{
+    double total = 0;
+    for (int i = 0; i < repeats; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        CNF cnf = reader();
+        total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (i == repeats - 1)
+            result = cnf;
+    }
+
+    return total / repeats;
+}
+
+int main(int argc, char** argv)
+{
+    std::string generated;
+    if (argc == 1)
+        generated = GenerateInstance(1000000, 4200000);
+
+    int files_count = argc == 1 ? 1 : argc - 1;
+    int err_count = 0;
+
+    for (int f_no = 0; f_no < files_count; f_no++)
+    {
+        const char* filename = argc == 1 ? generated.c_str() : argv[f_no + 1];
+
+        CNF legacy, streaming;
+        DIMACS::ParseResult parsed;
+        double legacy_time = Measure([&]() { return DIMACS::ReadFromFileLegacy(filename); }, 3, legacy);
+        double streaming_time = Measure([&]() { return DIMACS::ReadFromFile(filename, &parsed); }, 3, streaming);
+
+        if (not parsed.ok)
+        {
+            fprintf(stderr, "%s:%lu:%lu: %s\n", filename, parsed.line, parsed.column, parsed.message.c_str());
+            err_count++;
+            continue;
+        }
+
+        // Both parsers must produce the same clauses
+        bool same = legacy.ToRawString() == streaming.ToRawString();
+        err_count += not same;
+
+        printf("%s: %u clauses, legacy %.2f ms, streaming %.2f ms, speedup %.2fx%s\n",
+               filename, streaming.ClausesCount(), legacy_time, streaming_time, legacy_time / streaming_time,
+               same ? "" : " (MISMATCH)");
+    }
+
+    if (not generated.empty())
+        remove(generated.c_str());
+
+    return err_count != 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "literal.hxx"
+#include "dprintf.hxx"
+
+/// Lock-free ring of short clauses shared between solvers running in parallel.
+/// Every solver writes to the same ring and reads it with its own cursor,
+/// clauses which were overwritten or not finished before solver got to them are just lost.
+class ClauseExchange
+{
+public:
+
+    static const uint32_t MaxClauseSize = 8;
+
+    ClauseExchange(uint32_t capacity);
+    ClauseExchange(ClauseExchange&) = delete;
+    ~ClauseExchange();
+
+    bool Export(uint32_t author, const Literal* literals, uint32_t size); /// Publishing clause, returning false if it was dropped
+    template <class Callback>
+    void Import(uint32_t reader, uint64_t& cursor, Callback imported); /// Calling imported(literals, size) for every new clause of other authors
+
+    uint64_t Exported();
+
+private:
+
+    /// Slot is guarded by its sequence number: odd while clause is written,
+    /// 2 * (position + 1) when clause from position is ready to be read
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence { 0 };
+        std::atomic<uint32_t> author { 0 };
+        std::atomic<uint32_t> size { 0 };
+        std::atomic<Literal> literals[MaxClauseSize];
+    };
+
+    Slot* _slots = nullptr;
+    uint32_t _capacity = 0;
+    std::atomic<uint64_t> _tail { 0 }; /// Position for next exported clause
+};
+
+ClauseExchange::ClauseExchange(uint32_t capacity = 4096) : _capacity(capacity)
+{
+    _slots = new Slot[_capacity];
+}
+
+ClauseExchange::~ClauseExchange()
+{
+    delete[] _slots;
+}
+
+bool ClauseExchange::Export(uint32_t author, const Literal* literals, uint32_t size)
+{
+    if (size == 0 or size > MaxClauseSize)
+        return false;
+
+    uint64_t position = _tail.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = _slots[position % _capacity];
+
+    // If writer from previous lap is still busy with this slot, clause is dropped instead of waiting
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    if (sequence % 2 == 1 or sequence >= 2 * position + 1 or
+        not slot.sequence.compare_exchange_strong(sequence, 2 * position + 1, std::memory_order_acq_rel))
+        return false;
+
+    // Odd sequence has to be visible before any of data stores, otherwise reader could see new literals
+    // together with old even sequence in its recheck and take torn clause (pairs with fence in Import)
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.author.store(author, std::memory_order_relaxed);
+    slot.size.store(size, std::memory_order_relaxed);
+    for (uint32_t lit_no = 0; lit_no < size; lit_no++)
+        slot.literals[lit_no].store(literals[lit_no], std::memory_order_relaxed);
+
+    slot.sequence.store(2 * position + 2, std::memory_order_release);
+    return true;
+}
+
+template <class Callback>
+void ClauseExchange::Import(uint32_t reader, uint64_t& cursor, Callback imported)
+{
+    Literal literals[MaxClauseSize];
+
+    uint64_t tail = _tail.load(std::memory_order_acquire);
+    if (tail > cursor + _capacity)
+    {
+        dprintf("Reader %u lost %lu shared clauses\n", reader, tail - _capacity - cursor);
+        cursor = tail - _capacity;
+    }
+
+    for (; cursor < tail; cursor++)
+    {
+        Slot& slot = _slots[cursor % _capacity];
+
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        // Slot which is still written, was given up by its writer or was already overwritten
+        // is skipped, so one torn slot never hides clauses after it
+        if (sequence != 2 * cursor + 2)
+            continue;
+
+        uint32_t author = slot.author.load(std::memory_order_relaxed);
+        uint32_t size = slot.size.load(std::memory_order_relaxed);
+        for (uint32_t lit_no = 0; lit_no < size and lit_no < MaxClauseSize; lit_no++)
+            literals[lit_no] = slot.literals[lit_no].load(std::memory_order_relaxed);
+
+        // Clause is valid only if no writer took the slot while it was copied (pairs with fence in Export)
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        if (author != reader)
+            imported(literals, size);
+    }
+}
+
+uint64_t ClauseExchange::Exported()
+{
+    return _tail.load(std::memory_order_relaxed);
+}
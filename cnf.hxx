@@ -1,7 +1,11 @@
 #pragma once
 #include <cstring>
+#include <cstdlib>
 #include <list>
+#include <vector>
 #include "literal.hxx"
+#include "literal_storage.hxx"
+#include "dprintf.hxx"
 
 class CNF
 {
@@ -19,12 +23,13 @@ public:
     };
 
     CNF();
-    CNF(CNF& other); /// Copy constructor (necessary to save intermediate states)
+    CNF(CNF& other); /// Copy constructor, copies only clauses remaining in other
     CNF& operator=(CNF& other);
     ~CNF();
 
     bool IsUnsatPropagation(Literal literal); /// Checking if propagating of literal will cause UNSAT for this branch
 
+    int8_t Value(Literal literal); /// 1 if literal is true, -1 if false, 0 if unassigned
     PureResult IsPure(Literal literal); /// Checking if literal pure or not
     Literal FindSingularClause(); /// Finding first single clause in CNF and returning literal from this clause
     Literal FindPureLiteral(); /// Finding first pure literal in CNF
@@ -32,6 +37,15 @@ public:
     Literal LastLiteral(); /// Returning last literal in CNF
 
     ActionResult PropagateUnit(Literal literal); /// Removing all clauses with literal and all contra-literal occurancies from remaining clauses
+    ActionResult Check(); /// Checking if CNF is already devasted or contains empty clause
+    void TrackPureLiterals(); /// Counting occurrences of remaining literals on every assignment, prepared CNF gets counts of its current state
+
+    void NewDecisionLevel(); /// Marking trail, all following propagations can be undone with Backtrack
+    void Backtrack(uint32_t level); /// Undoing all propagations made after decision level was opened
+    template <class Callback>
+    void Backtrack(uint32_t level, Callback unassigned); /// Same, calling unassigned(literal) for every undone literal
+    Literal* ConflictClause(uint32_t& size); /// Original literals of some clause that became empty
+    uint32_t DecisionLevel();
 
     ActionResult RemoveTrivialClauses(); /// Rule 0: Removing trivial clauses from CNF
     ActionResult RemoveSingularClauses(); /// Rule 1: Propagating units from singular clauses
@@ -39,33 +53,59 @@ public:
 
     uint32_t ClausesCount();
     uint32_t VariablesCount();
+    uint64_t Propagations(); /// Literals assigned since search state was built, decisions included
     std::string ToRawString();
     std::string ToString();
 
     friend class DIMACS;
+    friend class Propagator;
+    friend class Brancher;
+    friend class Preprocessor;
 
 private:
-    Literal _single_literal = EmptyLiteral;
 
-    uintptr_t _cnf_data_size = 0; /// Current size of _cnf_data
+    static uint32_t _index(Literal literal); /// Position of literal in occurrence lists
+    void _prepare(); /// Building occurrence lists and trail, called before first propagation
+    void _assign(Literal literal);
+    void _unassign(Literal literal);
+    void _copy(CNF& other);
+    void _free();
+    void _reset(); /// Dropping search state, it is rebuilt from _cnf_data on next _prepare
+
+    uintptr_t _cnf_data_size = 0; /// Size of _cnf_data, it is never changed by propagation
     Literal* _cnf_data = nullptr; /// Clauses separated by EmptyLiteral (also after last element)
 
     uint32_t _variables_count = 0; /// Count of variables used in cnf
-    uint32_t _clauses_count = 0; /// Count of clauses in cnf
+    uint32_t _clauses_count = 0; /// Count of clauses not satisfied yet
+
+    uint32_t _total_clauses = 0; /// Count of clauses in _cnf_data
+    uintptr_t* _clause_starts = nullptr; /// Index of first literal of every clause in _cnf_data
+    uint32_t* _clause_sizes = nullptr; /// Count of literals in clause which are not false
+    Literal* _satisfied_by = nullptr; /// Literal which satisfied clause or EmptyLiteral
+    uint32_t _empty_clauses = 0; /// Count of clauses with all literals false
+    uint32_t _conflict = 0; /// Last clause which became empty
+
+    uintptr_t* _occurrence_starts = nullptr; /// Occurrences of literal are in [start(literal), start(literal + 1))
+    uint32_t* _occurrences = nullptr; /// Clauses containing literal, grouped by _index(literal)
+
+    int8_t* _values = nullptr; /// 1 for true, -1 for false, 0 for unassigned variable
+    Literal* _trail = nullptr; /// Assigned literals in order of assignment
+    uint32_t _trail_size = 0;
+    uint32_t* _trail_limits = nullptr; /// Trail size at the moment every decision level was opened
+    uint32_t _decision_level = 0;
+    uint64_t _propagations = 0;
+
+    std::vector<uint32_t> _singular; /// Clauses which became singular since last backtrack
+    bool _track_pure = false;
+    LiteralStorage _literals; /// Occurrences of literals in remaining clauses, collects literals which became pure
+    uint32_t _first_clause = 0; /// All clauses before this one are satisfied
 };
 
 CNF::CNF() { }
 
 CNF::CNF(CNF& other)
 {
-    _cnf_data_size = other._cnf_data_size;
-    _cnf_data = new Literal[_cnf_data_size] { 0 };
-    memcpy(_cnf_data, other._cnf_data, _cnf_data_size * sizeof(Literal));
-
-    _variables_count = other._variables_count;
-    _clauses_count = other._clauses_count;
-
-    _single_literal = EmptyLiteral;
+    _copy(other);
 }
 
 CNF& CNF::operator=(CNF& other)
@@ -73,87 +113,330 @@ CNF& CNF::operator=(CNF& other)
     if (this == &other)
         return *this;
 
-    if (_cnf_data)
+    _free();
+    _copy(other);
+
+    return *this;
+}
+
+CNF::~CNF()
+{
+    _free();
+}
+
+void CNF::_copy(CNF& other)
+{
+    _variables_count = other._variables_count;
+
+    if (not other._clause_starts)
     {
-        delete[] _cnf_data;
-        _cnf_data = nullptr;
-        _cnf_data_size = 0;
+        _cnf_data_size = other._cnf_data_size;
+        _cnf_data = new Literal[_cnf_data_size]();
+        memcpy(_cnf_data, other._cnf_data, _cnf_data_size * sizeof(Literal));
+        _clauses_count = other._clauses_count;
+        return;
     }
 
-    _cnf_data_size = other._cnf_data_size;
-    _cnf_data = new Literal[_cnf_data_size] { 0 };
-    memcpy(_cnf_data, other._cnf_data, _cnf_data_size * sizeof(Literal));
+    // Other CNF is in the middle of search, so only remaining part of it is copied
+    _cnf_data = new Literal[other._cnf_data_size]();
+    _cnf_data_size = 0;
+    _clauses_count = 0;
 
-    _variables_count = other._variables_count;
-    _clauses_count = other._clauses_count;
+    for (uint32_t clause = 0; clause < other._total_clauses; clause++)
+    {
+        if (other._satisfied_by[clause] != EmptyLiteral)
+            continue;
 
-    _single_literal = EmptyLiteral;
+        for (uintptr_t idx = other._clause_starts[clause]; other._cnf_data[idx] != EmptyLiteral; idx++)
+            if (other.Value(other._cnf_data[idx]) == 0)
+                _cnf_data[_cnf_data_size++] = other._cnf_data[idx];
 
-    return *this;
+        _cnf_data[_cnf_data_size++] = EmptyLiteral;
+        _clauses_count++;
+    }
 }
 
-CNF::~CNF()
+void CNF::_free()
+{
+    delete[] _cnf_data;
+    _cnf_data = nullptr;
+    _cnf_data_size = 0;
+
+    _reset();
+}
+
+void CNF::_reset()
+{
+    delete[] _clause_starts;
+    delete[] _clause_sizes;
+    delete[] _satisfied_by;
+    delete[] _occurrence_starts;
+    delete[] _occurrences;
+    delete[] _values;
+    delete[] _trail;
+    delete[] _trail_limits;
+
+    _clause_starts = nullptr;
+    _clause_sizes = nullptr;
+    _satisfied_by = nullptr;
+    _occurrence_starts = nullptr;
+    _occurrences = nullptr;
+    _values = nullptr;
+    _trail = nullptr;
+    _trail_limits = nullptr;
+
+    _trail_size = 0;
+    _decision_level = 0;
+    _propagations = 0;
+    _empty_clauses = 0;
+    _first_clause = 0;
+    _singular.clear();
+}
+
+void CNF::_prepare()
+{
+    if (_clause_starts)
+        return;
+
+    _total_clauses = 0;
+    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    {
+        if (_cnf_data[idx] == EmptyLiteral)
+            _total_clauses++;
+        else if ((uint32_t) abs(_cnf_data[idx]) > _variables_count)
+            _variables_count = abs(_cnf_data[idx]);
+    }
+
+    _clauses_count = _total_clauses;
+    _clause_starts = new uintptr_t[_total_clauses + 1] { 0 };
+    _clause_sizes = new uint32_t[_total_clauses + 1] { 0 };
+    _satisfied_by = new Literal[_total_clauses + 1] { EmptyLiteral };
+    _occurrence_starts = new uintptr_t[2 * (_variables_count + 1) + 1] { 0 };
+    _occurrences = new uint32_t[_cnf_data_size + 1] { 0 };
+    _values = new int8_t[_variables_count + 1] { 0 };
+    _trail = new Literal[_variables_count + 1] { EmptyLiteral };
+    _trail_limits = new uint32_t[_variables_count + 2] { 0 };
+    if (_track_pure)
+        _literals.Allocate(_variables_count);
+
+    // Counting occurrences of every literal, then turning counts into list starts
+    uint32_t clause = 0;
+    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    {
+        if (_cnf_data[idx] == EmptyLiteral)
+        {
+            if (_clause_sizes[clause] == 0)
+            {
+                _empty_clauses++;
+                _conflict = clause;
+            }
+            else if (_clause_sizes[clause] == 1)
+                _singular.push_back(clause);
+
+            _clause_starts[++clause] = idx + 1;
+            continue;
+        }
+
+        _clause_sizes[clause]++;
+        _occurrence_starts[_index(_cnf_data[idx]) + 1]++;
+        if (_track_pure)
+            _literals.Add(_cnf_data[idx]);
+    }
+
+    for (uint32_t idx = 1; idx <= 2 * (_variables_count + 1); idx++)
+        _occurrence_starts[idx] += _occurrence_starts[idx - 1];
+
+    uintptr_t* filled = new uintptr_t[2 * (_variables_count + 1)] { 0 };
+    clause = 0;
+    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    {
+        if (_cnf_data[idx] == EmptyLiteral)
+        {
+            clause++;
+            continue;
+        }
+
+        uint32_t literal_idx = _index(_cnf_data[idx]);
+        _occurrences[_occurrence_starts[literal_idx] + filled[literal_idx]++] = clause;
+    }
+    delete[] filled;
+
+    if (_track_pure)
+        _literals.CollectPure();
+
+    dprintf("Prepared CNF of %d clauses over %d variables for search\n", _total_clauses, _variables_count);
+}
+
+uint32_t CNF::_index(Literal literal)
+{
+    return literal < 0 ? 2 * (-literal) + 1 : 2 * literal;
+}
+
+int8_t CNF::Value(Literal literal)
+{
+    int8_t value = _values[abs(literal)];
+    return literal < 0 ? -value : value;
+}
+
+void CNF::_assign(Literal literal)
 {
-    if (_cnf_data)
+    _values[abs(literal)] = literal < 0 ? -1 : 1;
+    _trail[_trail_size++] = literal;
+    _propagations++;
+
+    uint32_t idx = _index(-literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1]; occ++)
     {
-        delete[] _cnf_data;
-        _cnf_data = nullptr;
-        _cnf_data_size = 0;
+        uint32_t clause = _occurrences[occ];
+        if (_track_pure and _satisfied_by[clause] == EmptyLiteral)
+            _literals.Remove(-literal);
+
+        switch (--_clause_sizes[clause])
+        {
+            case 0:
+                _empty_clauses++;
+                _conflict = clause;
+                dprintf("Empty clause created while removing literal %d\n", -literal);
+                break;
+
+            case 1:
+                if (_satisfied_by[clause] == EmptyLiteral)
+                    _singular.push_back(clause);
+                break;
+        }
+    }
+
+    // False literals of satisfied clause were already removed from occurrence counts
+    idx = _index(literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1]; occ++)
+    {
+        uint32_t clause = _occurrences[occ];
+        if (_satisfied_by[clause] == EmptyLiteral)
+        {
+            _satisfied_by[clause] = literal;
+            _clauses_count--;
+
+            for (uintptr_t lit_idx = _clause_starts[clause]; _track_pure and _cnf_data[lit_idx] != EmptyLiteral; lit_idx++)
+                if (Value(_cnf_data[lit_idx]) != -1)
+                    _literals.Remove(_cnf_data[lit_idx]);
+        }
     }
 }
 
+void CNF::_unassign(Literal literal)
+{
+    // Exactly reversed _assign, so occurrence counts are restored to the same values
+    uint32_t idx = _index(literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1]; occ++)
+    {
+        uint32_t clause = _occurrences[occ];
+        if (_satisfied_by[clause] == literal)
+        {
+            _satisfied_by[clause] = EmptyLiteral;
+            _clauses_count++;
+            if (clause < _first_clause)
+                _first_clause = clause;
+
+            for (uintptr_t lit_idx = _clause_starts[clause]; _track_pure and _cnf_data[lit_idx] != EmptyLiteral; lit_idx++)
+                if (Value(_cnf_data[lit_idx]) != -1)
+                    _literals.Add(_cnf_data[lit_idx]);
+        }
+    }
+
+    idx = _index(-literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1]; occ++)
+    {
+        uint32_t clause = _occurrences[occ];
+        if (_clause_sizes[clause]++ == 0)
+            _empty_clauses--;
+
+        if (_track_pure and _satisfied_by[clause] == EmptyLiteral)
+            _literals.Add(-literal);
+    }
+
+    _values[abs(literal)] = 0;
+}
+
 bool CNF::IsUnsatPropagation(Literal literal)
 {
-    return false;
+    _prepare();
+
+    if (Value(literal) != 0)
+        return Value(literal) == -1;
+
+    // Literal is propagated with all units it implies on temporary level
+    uint32_t level = _decision_level;
+    NewDecisionLevel();
+
+    ActionResult res = PropagateUnit(literal);
+    if (res == ActionResult::OK)
+        res = RemoveSingularClauses();
+
+    Backtrack(level);
+
+    return res == ActionResult::EMPTY_CLAUSE_CREATED;
 }
 
 CNF::PureResult CNF::IsPure(Literal literal)
 {
+    _prepare();
+
     bool found = false;
     bool found_negation = false;
 
-    for (int i = 0; i < _cnf_data_size; i++)
+    if (_track_pure)
     {
-        if (_cnf_data[i] == literal)
-            found = true;
-        else if (_cnf_data[i] == -literal)
-            found_negation = true;
+        found = _literals.Occurrences(literal) > 0;
+        found_negation = _literals.Occurrences(-literal) > 0;
+        return { found != found_negation, found_negation };
     }
 
+    uint32_t idx = _index(literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1] and not found; occ++)
+        found = _satisfied_by[_occurrences[occ]] == EmptyLiteral;
+
+    idx = _index(-literal);
+    for (uintptr_t occ = _occurrence_starts[idx]; occ < _occurrence_starts[idx + 1] and not found_negation; occ++)
+        found_negation = _satisfied_by[_occurrences[occ]] == EmptyLiteral;
+
     return { found != found_negation, found_negation };
 }
 
 Literal CNF::FindSingularClause()
 {
-    // Propagate (single way to edit CNF) updating list of single literals, 
-    // so it is necessary to search in cycle only if CNF not edited
-    if (_single_literal == EmptyLiteral)
-    {        
-        bool first_literal_in_clause = true;
+    _prepare();
 
-        for (int i = 0; i < _cnf_data_size; i++)
-        {
-            if (first_literal_in_clause and _cnf_data[i + 1] == EmptyLiteral)
-                return _cnf_data[i];
+    // Assignment is the single way to edit CNF and it collects clauses
+    // that became singular, so there is no need to search through whole CNF
+    while (not _singular.empty())
+    {
+        uint32_t clause = _singular.back();
+        _singular.pop_back();
 
-            if (first_literal_in_clause)
-                first_literal_in_clause = false;
+        if (_satisfied_by[clause] != EmptyLiteral or _clause_sizes[clause] != 1)
+            continue;
 
-            if (_cnf_data[i] == EmptyLiteral)
-                first_literal_in_clause = true;
-        }
+        for (uintptr_t idx = _clause_starts[clause]; _cnf_data[idx] != EmptyLiteral; idx++)
+            if (Value(_cnf_data[idx]) == 0)
+                return _cnf_data[idx];
     }
 
-    Literal found = _single_literal;
-    _single_literal = EmptyLiteral;
-
-    return found;
+    return EmptyLiteral;
 }
 
 Literal CNF::FindPureLiteral()
 {
-    for (Literal literal = 1; literal <= _variables_count; literal++)
+    _prepare();
+
+    // Occurrences are counted only for unassigned literals, so every pure literal is unassigned
+    if (_track_pure)
+        return _literals.PopPure();
+
+    for (Literal literal = 1; literal <= (Literal) _variables_count; literal++)
     {
+        if (_values[literal] != 0)
+            continue;
+
         auto res = IsPure(literal);
         if (res.pure)
             return res.negative ? -literal : literal;
@@ -164,118 +447,211 @@ Literal CNF::FindPureLiteral()
 
 Literal CNF::FirstLiteral()
 {
-    if (_cnf_data_size > 0 and _cnf_data[0] != EmptyLiteral)
-        return _cnf_data[0];
-    
+    _prepare();
+
+    while (_first_clause < _total_clauses and _satisfied_by[_first_clause] != EmptyLiteral)
+        _first_clause++;
+
+    if (_first_clause < _total_clauses)
+        for (uintptr_t idx = _clause_starts[_first_clause]; _cnf_data[idx] != EmptyLiteral; idx++)
+            if (Value(_cnf_data[idx]) == 0)
+                return _cnf_data[idx];
+
     return EmptyLiteral;
 }
 
-Literal CNF::FirstLiteral()
+Literal CNF::LastLiteral()
 {
-    if (_cnf_data_size > 0 and _cnf_data[0] != EmptyLiteral)
-        return _cnf_data[0];
-    
+    _prepare();
+
+    for (uint32_t clause = _total_clauses; clause > 0; clause--)
+    {
+        if (_satisfied_by[clause - 1] != EmptyLiteral)
+            continue;
+
+        Literal last = EmptyLiteral;
+        for (uintptr_t idx = _clause_starts[clause - 1]; _cnf_data[idx] != EmptyLiteral; idx++)
+            if (Value(_cnf_data[idx]) == 0)
+                last = _cnf_data[idx];
+
+        if (last != EmptyLiteral)
+            return last;
+    }
+
     return EmptyLiteral;
 }
 
 CNF::ActionResult CNF::PropagateUnit(Literal literal)
 {
-    int old_clause_size = 0;
-    int new_clause_size = 0;
+    _prepare();
 
-    bool clause_removed = false;
+    int8_t value = Value(literal);
+    if (value == -1)
+    {
+        dprintf("Literal %d is already false\n", literal);
+        return ActionResult::EMPTY_CLAUSE_CREATED;
+    }
 
-    int new_idx = 0;
+    if (value == 0)
+        _assign(literal);
 
-    for (int old_idx = 0; old_idx < _cnf_data_size; old_idx++)
-    {
-        old_clause_size++;
-        Literal current = _cnf_data[old_idx];
+    return Check();
+}
 
-        bool clause_end = current == EmptyLiteral;
+CNF::ActionResult CNF::Check()
+{
+    _prepare();
 
-        if (current == -literal) // Just skipping contra-literals
-        {
-            _cnf_data[old_idx] = EmptyLiteral;
+    if (_empty_clauses > 0)
+        return ActionResult::EMPTY_CLAUSE_CREATED;
 
-            dprintf("Literal %d removed from clause\n", -literal);
-        }
+    return _clauses_count == 0 ? ActionResult::CNF_DEVASTED : ActionResult::OK;
+}
 
-        else if (current == literal) // Deleting copied literals of this clause and skipping uncopied ending
-        {
-            while (new_idx > 0 and _cnf_data[new_idx - 1] != EmptyLiteral)
-                _cnf_data[--new_idx] = EmptyLiteral;
-        
-            while (old_idx < _cnf_data_size and _cnf_data[old_idx++] != EmptyLiteral)
-                _cnf_data[old_idx - 1] = EmptyLiteral;
-            
-            old_idx--;
-            clause_removed = true;
-            _clauses_count--;
-            clause_end = true;
+void CNF::NewDecisionLevel()
+{
+    _prepare();
+    _trail_limits[_decision_level++] = _trail_size;
+}
 
-            dprintf("Whole clause with literal %d removed\n", literal);
-        }
+void CNF::Backtrack(uint32_t level)
+{
+    Backtrack(level, [](Literal) { });
+}
 
-        else
-        {
-            _cnf_data[new_idx++] = current;
-            new_clause_size++;
-        }
+template <class Callback>
+void CNF::Backtrack(uint32_t level, Callback unassigned)
+{
+    if (level >= _decision_level)
+        return;
 
-        if (clause_end)
-        {
-            if (not clause_removed)
-            {
-                new_clause_size--;
-                old_clause_size--;
-
-                switch (new_clause_size)
-                {
-                    case 0:
-                    {
-                        dprintf("Empty clause created while removing literal %d\n", literal);
-                        return ActionResult::EMPTY_CLAUSE_CREATED;
-                    }
-                    
-                    case 1:
-                    {
-                        if (old_clause_size == 2)
-                        {
-                            _single_literal = _cnf_data[new_idx - 2];
-                            dprintf("Singular clause of literal %d created while removing literal %d\n", _cnf_data[new_idx - 2], literal);
-                        }
-                    }
-                }
-            }
-            else
-                clause_removed = false;
+    uint32_t trail_size = _trail_limits[level];
+    while (_trail_size > trail_size)
+    {
+        Literal literal = _trail[--_trail_size];
+        _unassign(literal);
+        unassigned(literal);
+    }
 
-            new_clause_size = 0;
-            old_clause_size = 0;
-        }
+    _decision_level = level;
+
+    // State on this level was already cleaned from singular clauses and pure literals
+    _singular.clear();
+    if (_track_pure)
+        _literals.ClearPure();
+
+    dprintf("Backtracked to level %d, %d literals assigned\n", level, _trail_size);
+}
+
+void CNF::TrackPureLiterals()
+{
+    if (_track_pure)
+        return;
+
+    _track_pure = true;
+    if (not _clause_starts)
+        return;
+
+    // CNF was already prepared (e.g. by preprocessor), so counts are built the way assignments keep them:
+    // unassigned literals of clauses which are not satisfied
+    _literals.Allocate(_variables_count);
+    for (uint32_t clause = 0; clause < _total_clauses; clause++)
+    {
+        if (_satisfied_by[clause] != EmptyLiteral)
+            continue;
+
+        for (uintptr_t idx = _clause_starts[clause]; _cnf_data[idx] != EmptyLiteral; idx++)
+            if (Value(_cnf_data[idx]) == 0)
+                _literals.Add(_cnf_data[idx]);
     }
 
-    _cnf_data_size = new_idx;
+    _literals.CollectPure();
+    dprintf("Pure literals are tracked from level %d\n", _decision_level);
+}
 
-    return _cnf_data_size == 0 ? ActionResult::CNF_DEVASTED : ActionResult::OK;
+uint32_t CNF::DecisionLevel()
+{
+    return _decision_level;
+}
+
+Literal* CNF::ConflictClause(uint32_t& size)
+{
+    size = 0;
+    if (_empty_clauses == 0)
+        return nullptr;
+
+    size = _clause_starts[_conflict + 1] - _clause_starts[_conflict] - 1;
+    return _cnf_data + _clause_starts[_conflict];
 }
 
 CNF::ActionResult CNF::RemoveTrivialClauses()
 {
     dprintf("Removing trivial clauses\n", nullptr);
-    return ActionResult::OK;
+
+    // Clauses are rewritten in place, so it can be done only before first assignment
+    if (_trail_size > 0)
+        return Check();
+
+    uint32_t variables_count = _variables_count;
+    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+        if ((uint32_t) abs(_cnf_data[idx]) > variables_count)
+            variables_count = abs(_cnf_data[idx]);
+
+    // Sign of literal already met in current clause, cleaned after every clause
+    std::vector<int8_t> met(variables_count + 1, 0);
+
+    uintptr_t size = 0;
+    uintptr_t clause_start = 0;
+    bool tautology = false;
+    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    {
+        Literal literal = _cnf_data[idx];
+        if (literal != EmptyLiteral)
+        {
+            int8_t sign = literal < 0 ? -1 : 1;
+            if (met[abs(literal)] == -sign)
+                tautology = true;
+            else if (met[abs(literal)] == 0)
+            {
+                met[abs(literal)] = sign;
+                _cnf_data[size++] = literal;
+            }
+            continue;
+        }
+
+        for (uintptr_t lit_idx = clause_start; lit_idx < size; lit_idx++)
+            met[abs(_cnf_data[lit_idx])] = 0;
+
+        if (tautology)
+            size = clause_start;
+        else
+            _cnf_data[size++] = EmptyLiteral;
+
+        clause_start = size;
+        tautology = false;
+    }
+
+    dprintf("%lu literals left out of %lu\n", size, _cnf_data_size);
+
+    _cnf_data_size = size;
+    _reset();
+
+    return Check();
 }
 
 CNF::ActionResult CNF::RemoveSingularClauses()
 {
     dprintf("Removing singular clauses\n", nullptr);
+
+    ActionResult res = Check();
+    if (res != ActionResult::OK) return res;
+
     Literal propagating = FindSingularClause();
     while (propagating != EmptyLiteral)
     {
         dprintf("Removing literal %d\n", propagating);
 
-        ActionResult res = PropagateUnit(propagating);
+        res = PropagateUnit(propagating);
 
         dprintf("Literal %d removed\n", propagating);
 
@@ -292,12 +668,15 @@ CNF::ActionResult CNF::RemovePureLiterals()
 {
     dprintf("Removing clauses with pure literals\n", nullptr);
 
+    ActionResult res = Check();
+    if (res != ActionResult::OK) return res;
+
     Literal propagating = FindPureLiteral();
     while (propagating != EmptyLiteral)
     {
         dprintf("Removing pure literal %d\n", propagating);
 
-        ActionResult res = PropagateUnit(propagating);
+        res = PropagateUnit(propagating);
         if (res != ActionResult::OK) return res;
 
         propagating = FindPureLiteral();
@@ -316,16 +695,23 @@ uint32_t CNF::VariablesCount()
     return _variables_count;
 }
 
+uint64_t CNF::Propagations()
+{
+    return _propagations;
+}
+
 std::string CNF::ToRawString()
 {
+    CNF remaining = *this;
+
     char buffer[50] = { 0 };
     std::string result = "[";
-    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    for (uintptr_t idx = 0; idx < remaining._cnf_data_size; idx++)
     {
-        sprintf(buffer, "%d, ", _cnf_data[idx]);
+        sprintf(buffer, "%d, ", remaining._cnf_data[idx]);
         result = result.append(buffer);
     }
-    if (_cnf_data_size > 0)
+    if (remaining._cnf_data_size > 0)
     {
         result.pop_back();
         result.pop_back();
@@ -336,15 +722,17 @@ std::string CNF::ToRawString()
 
 std::string CNF::ToString()
 {
+    CNF remaining = *this;
+
     char buffer[50] = { 0 };
     std::string result = "0: [";
     int clause_no = 1;
 
-    for (uintptr_t idx = 0; idx < _cnf_data_size; idx++)
+    for (uintptr_t idx = 0; idx < remaining._cnf_data_size; idx++)
     {
-        if (_cnf_data[idx] == EmptyLiteral)
+        if (remaining._cnf_data[idx] == EmptyLiteral)
         {
-            if (clause_no >= _clauses_count)
+            if (clause_no >= remaining._clauses_count)
                 break;
             result.pop_back();
             sprintf(buffer, "]\n%d: [", clause_no++);
@@ -352,7 +740,7 @@ std::string CNF::ToString()
         }
         else
         {
-            sprintf(buffer, "%d ", _cnf_data[idx]);
+            sprintf(buffer, "%d ", remaining._cnf_data[idx]);
             result = result.append(buffer);
         }
     }
@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "solver.hxx"
+#include "threads.hxx"
+#include "cube_pool.hxx"
+#include "propagator.hxx"
+#include "heuristic.hxx"
+#include "cnf.hxx"
+#include "rules.hxx"
+#include "dprintf.hxx"
+
+/// Splitting CNF into cubes up to fixed depth and solving them in parallel threads.
+/// Workers which ran out of cubes steal unexplored branches from busy ones
+class CubeAndConquer
+{
+public:
+
+    CubeAndConquer(uint32_t threads, uint32_t depth, Rule rules, Heuristic heuristic);
+    CubeAndConquer(CubeAndConquer&) = delete;
+
+    Solver::Status Solve(CNF& cnf);
+    void StopOn(const std::atomic<bool>* stop); /// Making Solve return UNKNOWN as soon as flag is raised
+
+    uint64_t Complexity(); /// Sum of complexities of all workers
+    const Solver::Statistics& Stats(); /// Sum of counters of all workers
+    std::vector<Literal>& Model(); /// Model found by one of workers if answer is SAT
+    uint32_t CubesCount(); /// Cubes produced by splitting, not counting branches given away later
+    uint64_t Stolen();
+
+private:
+
+    void _split(Propagator& propagator, Brancher& brancher, std::vector<Literal>& path, std::vector<std::vector<Literal>>& cubes);
+
+    uint32_t _threads = 1;
+    uint32_t _depth = 0;
+    Rule _rules = Rule::NONE;
+    Heuristic _heuristic = Heuristic::FIRST_LITERAL;
+    const std::atomic<bool>* _stop = nullptr;
+    uint64_t _complexity = 0;
+    Solver::Statistics _stats;
+    std::vector<Literal> _model;
+    uint32_t _cubes_count = 0;
+    uint64_t _stolen = 0;
+};
+
+CubeAndConquer::CubeAndConquer(uint32_t threads, uint32_t depth, Rule rules, Heuristic heuristic) :
+    _threads(threads == 0 ? AvailableThreads() : threads), _depth(depth), _rules(rules), _heuristic(heuristic) { }
+
+void CubeAndConquer::_split(Propagator& propagator, Brancher& brancher, std::vector<Literal>& path, std::vector<std::vector<Literal>>& cubes)
+{
+    // Branches refuted by propagation alone never become cubes
+    if (propagator.Propagate() != CNF::ActionResult::OK)
+        return;
+
+    Literal decision = path.size() < _depth ? brancher.Pick(propagator) : EmptyLiteral;
+    if (decision == EmptyLiteral)
+    {
+        cubes.push_back(path);
+        return;
+    }
+
+    auto unassigned = [&brancher](Literal literal) { brancher.Unassigned(literal); };
+
+    uint32_t level = propagator.DecisionLevel();
+    for (Literal branch : { decision, -decision })
+    {
+        propagator.NewDecisionLevel();
+        propagator.Assign(branch);
+        path.push_back(branch);
+
+        _split(propagator, brancher, path, cubes);
+
+        path.pop_back();
+        propagator.Backtrack(level, unassigned);
+    }
+}
+
+Solver::Status CubeAndConquer::Solve(CNF& cnf)
+{
+    std::vector<std::vector<Literal>> cubes;
+    std::vector<Literal> path;
+
+    {
+        Propagator propagator(cnf);
+        Brancher brancher(Heuristic::JEROSLOW_WANG, false);
+        brancher.Init(cnf);
+        _split(propagator, brancher, path, cubes);
+    }
+
+    _model.clear();
+    _complexity = 0;
+    _stats = Solver::Statistics();
+    _cubes_count = cubes.size();
+    dprintf("CNF split into %d cubes on depth %d\n", _cubes_count, _depth);
+
+    if (cubes.empty())
+        return Solver::Status::UNSAT;
+
+    CubePool pool(_threads);
+    for (uintptr_t idx = 0; idx < cubes.size(); idx++)
+        pool.Push(idx % _threads, cubes[idx]);
+
+    std::vector<Solver*> solvers;
+    std::vector<Solver::Status> results(_threads, Solver::Status::UNKNOWN);
+    std::vector<std::thread> threads;
+    CNF* copies = new CNF[_threads];
+
+    // Workers search as configured, but cubes are made of original variables, so they never preprocess
+    const Rule worker_rules = Rule::REMOVE_SINGULAR | Rule::WATCHED_LITERALS | (_rules & (Rule::CONFLICT_LEARNING | Rule::PHASE_SAVING));
+
+    for (uint32_t idx = 0; idx < _threads; idx++)
+    {
+        solvers.push_back(new Solver(worker_rules, _heuristic));
+        copies[idx] = cnf;
+    }
+
+    std::atomic<uint32_t> running { _threads };
+    for (uint32_t idx = 0; idx < _threads; idx++)
+    {
+        threads.emplace_back([&, idx]()
+        {
+            results[idx] = solvers[idx]->SolveCubes(copies[idx], pool, idx);
+            running--;
+        });
+    }
+
+    JoinThreads(threads, running, _stop, [&pool]() { pool.Stop(); });
+
+    // CNF is UNSAT only if every worker refuted all of its cubes
+    Solver::Status result = Solver::Status::UNSAT;
+    for (uint32_t idx = 0; idx < _threads; idx++)
+    {
+        _complexity += solvers[idx]->Complexity();
+        _stats.decisions += solvers[idx]->Stats().decisions;
+        _stats.propagations += solvers[idx]->Stats().propagations;
+        _stats.conflicts += solvers[idx]->Stats().conflicts;
+
+        if (results[idx] == Solver::Status::SAT and result != Solver::Status::SAT)
+        {
+            result = Solver::Status::SAT;
+            _model.swap(solvers[idx]->Model());
+        }
+        else if (results[idx] == Solver::Status::UNKNOWN and result != Solver::Status::SAT)
+            result = Solver::Status::UNKNOWN;
+    }
+
+    _stolen = pool.Stolen();
+    dprintf("Cube and conquer of %d threads finished, %lu cubes stolen\n", _threads, _stolen);
+
+    for (Solver* solver : solvers)
+        delete solver;
+    delete[] copies;
+
+    return result;
+}
+
+void CubeAndConquer::StopOn(const std::atomic<bool>* stop)
+{
+    _stop = stop;
+}
+
+uint64_t CubeAndConquer::Complexity()
+{
+    return _complexity;
+}
+
+const Solver::Statistics& CubeAndConquer::Stats()
+{
+    return _stats;
+}
+
+std::vector<Literal>& CubeAndConquer::Model()
+{
+    return _model;
+}
+
+uint32_t CubeAndConquer::CubesCount()
+{
+    return _cubes_count;
+}
+
+uint64_t CubeAndConquer::Stolen()
+{
+    return _stolen;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "literal.hxx"
+#include "dprintf.hxx"
+
+/// Cubes (partial assignments) waiting to be solved, one deque per worker.
+/// Worker takes its own cubes from the back and steals from the front of others,
+/// so stolen cubes are the shallowest, i.e. biggest ones
+class CubePool
+{
+public:
+
+    CubePool(uint32_t workers);
+    CubePool(CubePool&) = delete;
+    ~CubePool();
+
+    void Push(uint32_t worker, std::vector<Literal>& cube);
+    bool Pop(uint32_t worker, std::vector<Literal>& cube); /// Waiting for cube, returning false when all cubes are solved or pool is stopped
+    bool Hungry(); /// Checking if some worker waits for cube and there is nothing to take
+    void Stop(); /// Releasing all waiting workers and raising stop flag
+
+    const std::atomic<bool>* StopFlag();
+    uint64_t Stolen();
+
+private:
+
+    struct Deque
+    {
+        std::mutex mutex;
+        std::deque<std::vector<Literal>> cubes;
+    };
+
+    bool _take(uint32_t worker, std::vector<Literal>& cube);
+
+    Deque* _deques = nullptr;
+    uint32_t _workers = 0;
+
+    std::mutex _wait_mutex; /// Guards waiting, so push between check and wait can't be missed
+    std::condition_variable _wake;
+    std::atomic<uint32_t> _idle { 0 };
+    std::atomic<uint32_t> _queued { 0 }; /// Cubes in all deques
+    std::atomic<bool> _stop { false };
+    std::atomic<uint64_t> _stolen { 0 };
+};
+
+CubePool::CubePool(uint32_t workers) : _workers(workers)
+{
+    _deques = new Deque[_workers];
+}
+
+CubePool::~CubePool()
+{
+    delete[] _deques;
+}
+
+void CubePool::Push(uint32_t worker, std::vector<Literal>& cube)
+{
+    {
+        std::lock_guard<std::mutex> lock(_deques[worker].mutex);
+        _deques[worker].cubes.push_back(cube);
+        _queued++;
+    }
+
+    std::lock_guard<std::mutex> lock(_wait_mutex);
+    _wake.notify_one();
+}
+
+bool CubePool::Pop(uint32_t worker, std::vector<Literal>& cube)
+{
+    if (_take(worker, cube))
+        return true;
+
+    std::unique_lock<std::mutex> lock(_wait_mutex);
+    _idle++;
+
+    while (true)
+    {
+        if (_stop.load())
+            return false;
+
+        if (_take(worker, cube))
+        {
+            _idle--;
+            return true;
+        }
+
+        // Only busy workers produce cubes, so when nobody is busy the search is over
+        if (_idle.load() == _workers)
+        {
+            _wake.notify_all();
+            return false;
+        }
+
+        _wake.wait(lock);
+    }
+}
+
+bool CubePool::Hungry()
+{
+    return _idle.load(std::memory_order_relaxed) > _queued.load(std::memory_order_relaxed) and not _stop.load(std::memory_order_relaxed);
+}
+
+void CubePool::Stop()
+{
+    _stop.store(true);
+
+    std::lock_guard<std::mutex> lock(_wait_mutex);
+    _wake.notify_all();
+}
+
+const std::atomic<bool>* CubePool::StopFlag()
+{
+    return &_stop;
+}
+
+uint64_t CubePool::Stolen()
+{
+    return _stolen.load();
+}
+
+bool CubePool::_take(uint32_t worker, std::vector<Literal>& cube)
+{
+    for (uint32_t offset = 0; offset < _workers; offset++)
+    {
+        Deque& deque = _deques[(worker + offset) % _workers];
+        std::lock_guard<std::mutex> lock(deque.mutex);
+        if (deque.cubes.empty())
+            continue;
+
+        if (offset == 0)
+        {
+            cube.swap(deque.cubes.back());
+            deque.cubes.pop_back();
+        }
+        else
+        {
+            cube.swap(deque.cubes.front());
+            deque.cubes.pop_front();
+            _stolen++;
+        }
+
+        _queued--;
+        return true;
+    }
+
+    return false;
+}
@@ -3,20 +3,431 @@
 #include "literal.hxx"
 #include "dprintf.hxx"
 #include <list>
+#include <algorithm>
 #include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 class DIMACS
 {
 public:
-    static CNF ReadFromFile(const char name[]);
+
+    struct ParseResult
+    {
+        bool ok;
+        uint64_t line; /// Position of malformed input, both are counted from 1
+        uint64_t column;
+        std::string message;
+    };
+
+    static CNF ReadFromFile(const char filename[], ParseResult* result); /// Reading plain, gzip or xz compressed DIMACS, "-" reads stdin
+    static CNF ReadFromFileLegacy(const char filename[]); /// Old line based parser, kept to compare load time in bench_dimacs.cxx
 
 private:
+
+    /// Input either mapped to memory at once or read from descriptor by fixed chunks
+    struct Input
+    {
+        const char* data = nullptr;
+        uint64_t size = 0;
+        uint64_t position = 0;
+        uint64_t offset = 0; /// Position of data[0] in whole input
+
+        int fd = -1;
+        pid_t decompressor = -1;
+        bool mapped = false;
+        char* buffer = nullptr;
+
+        int Peek();
+        void Advance();
+        bool Refill();
+        uint64_t Offset();
+    };
+
+    static const uint64_t _chunk_size = 1 << 20;
+    static const uint64_t _magic_size = 6; /// Bytes enough to recognize any supported compression
+
+    static bool _open(const char filename[], Input& input, ParseResult& result);
+    static int _feed(Input& input); /// Starting process which writes bytes read ahead and the rest of stream to pipe, returning its read end
+    static bool _close(Input& input, bool drain); /// Releasing input, drained decompressor has to exit successfully
+    static void _parse(Input& input, CNF& cnf, ParseResult& result);
+    static void _grow(CNF& cnf, uint64_t& capacity);
+    static std::string _symbol(int sym); /// Printable form of symbol for error messages
+
     static long _readFile(const char filename[], char** destination);
     static void _allocateCNF(CNF& cnf, const char* clauses_text, const uint32_t clauses_count);
     static int _appendClause(Literal* destionation, char* clause_string);
 };
 
-CNF DIMACS::ReadFromFile(const char filename[])
+CNF DIMACS::ReadFromFile(const char filename[], ParseResult* result = nullptr)
+{
+    CNF cnf;
+    ParseResult local_result = { true, 0, 0, "" };
+    ParseResult& res = result ? *result : local_result;
+    res = { true, 0, 0, "" };
+
+    Input input;
+    if (_open(filename, input, res))
+        _parse(input, cnf, res);
+    if (not _close(input, res.ok) and res.ok)
+        res = { false, 0, 0, "decompressor failed" };
+
+    if (not res.ok and not result)
+        fprintf(stderr, "%s:%lu:%lu: %s\n", filename, res.line, res.column, res.message.c_str());
+
+    dprintf("Parsed %d clauses over %d variables\n", cnf._clauses_count, cnf._variables_count);
+
+    return cnf;
+}
+
+int DIMACS::Input::Peek()
+{
+    if (position == size and not Refill())
+        return -1;
+
+    return (unsigned char) data[position];
+}
+
+void DIMACS::Input::Advance()
+{
+    position++;
+}
+
+bool DIMACS::Input::Refill()
+{
+    if (mapped or fd < 0)
+        return false;
+
+    offset += size;
+    position = 0;
+
+    ssize_t readed = 0;
+    do
+        readed = read(fd, buffer, _chunk_size);
+    while (readed < 0 and errno == EINTR);
+
+    size = readed > 0 ? readed : 0;
+    return size > 0;
+}
+
+uint64_t DIMACS::Input::Offset()
+{
+    return offset + position;
+}
+
+bool DIMACS::_open(const char filename[], Input& input, ParseResult& result)
+{
+    // Every descriptor is closed on exec, so decompressors started from other threads or workers don't hold it
+    input.fd = strcmp(filename, "-") == 0 ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0) : open(filename, O_RDONLY | O_CLOEXEC);
+    if (input.fd < 0)
+    {
+        result = { false, 0, 0, std::string("can't open file: ") + strerror(errno) };
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(input.fd, &info) == 0 and S_ISREG(info.st_mode) and info.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, input.fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            input.data = (const char*) mapping;
+            input.size = info.st_size;
+            input.mapped = true;
+        }
+    }
+
+    // Streamed input can't be peeked, so its first bytes are read ahead into buffer
+    if (not input.mapped)
+    {
+        input.buffer = new char[_chunk_size];
+        input.data = input.buffer;
+        while (input.size < _magic_size)
+        {
+            ssize_t readed = read(input.fd, input.buffer + input.size, _chunk_size - input.size);
+            if (readed < 0 and errno == EINTR)
+                continue;
+            if (readed <= 0)
+                break;
+            input.size += readed;
+        }
+    }
+
+    // Compressed input is recognized by magic bytes and streamed through external decompressor
+    const char* decompressor = nullptr;
+    if (input.size >= 2 and memcmp(input.data, "\x1f\x8b", 2) == 0)
+        decompressor = "gzip";
+    else if (input.size >= 6 and memcmp(input.data, "\xfd" "7zXZ\x00", 6) == 0)
+        decompressor = "xz";
+
+    if (decompressor)
+    {
+        // Mapped file is read by decompressor from its start, while bytes read ahead from stream are fed to it first
+        if (input.mapped)
+        {
+            munmap((void*) input.data, input.size);
+            input.mapped = false;
+            input.size = 0;
+            input.buffer = new char[_chunk_size];
+            input.data = input.buffer;
+        }
+
+        int pipe_fds[2];
+        if (pipe2(pipe_fds, O_CLOEXEC) != 0)
+        {
+            result = { false, 0, 0, std::string("can't create pipe: ") + strerror(errno) };
+            return false;
+        }
+
+        input.decompressor = fork();
+        if (input.decompressor < 0)
+        {
+            result = { false, 0, 0, std::string("can't start ") + decompressor + ": " + strerror(errno) };
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+            return false;
+        }
+
+        if (input.decompressor == 0)
+        {
+            close(pipe_fds[0]);
+            dup2(pipe_fds[1], STDOUT_FILENO);
+            close(pipe_fds[1]);
+
+            int source = input.size > 0 ? _feed(input) : input.fd;
+            if (source < 0)
+                _exit(127);
+
+            dup2(source, STDIN_FILENO);
+            execlp(decompressor, decompressor, "-dc", (char*) nullptr);
+            _exit(127);
+        }
+
+        close(pipe_fds[1]);
+        close(input.fd);
+        input.fd = pipe_fds[0];
+        input.size = 0;
+
+        dprintf("Reading %s through %s\n", filename, decompressor);
+    }
+
+    return true;
+}
+
+int DIMACS::_feed(Input& input)
+{
+    int feed_fds[2];
+    if (pipe2(feed_fds, O_CLOEXEC) != 0)
+        return -1;
+
+    pid_t feeder = fork();
+    if (feeder < 0)
+        return -1;
+
+    if (feeder == 0)
+    {
+        // Feeder must not hold decompressor output, reader wouldn't get end of stream otherwise
+        close(STDOUT_FILENO);
+        close(feed_fds[0]);
+        do
+        {
+            for (uint64_t written = 0; written < input.size; )
+            {
+                ssize_t count = write(feed_fds[1], input.buffer + written, input.size - written);
+                if (count < 0 and errno == EINTR)
+                    continue;
+                if (count < 0)
+                    _exit(1);
+                written += count;
+            }
+        }
+        while (input.Refill());
+        _exit(0);
+    }
+
+    close(feed_fds[1]);
+    return feed_fds[0];
+}
+
+bool DIMACS::_close(Input& input, bool drain)
+{
+    // Parsing may stop before end of input (e.g. at SATLIB '%' line), and decompressor writing the rest
+    // would be killed by SIGPIPE once read end is closed, so its output is read to the end first
+    if (drain and input.decompressor > 0)
+        while (input.Refill());
+
+    if (input.mapped)
+        munmap((void*) input.data, input.size);
+    delete[] input.buffer;
+    if (input.fd >= 0)
+        close(input.fd);
+
+    if (input.decompressor <= 0)
+        return true;
+
+    int status = 0;
+    waitpid(input.decompressor, &status, 0);
+    return WIFEXITED(status) and WEXITSTATUS(status) == 0;
+}
+
+void DIMACS::_parse(Input& input, CNF& cnf, ParseResult& result)
+{
+    uint64_t line = 1;
+    uint64_t line_start = 0;
+    uint64_t capacity = 0;
+    bool header_presented = false;
+    bool in_clause = false;
+    uint32_t header_clauses = 0;
+
+    cnf._cnf_data_size = 0;
+    cnf._clauses_count = 0;
+
+    auto fail = [&](const std::string& message)
+    {
+        result = { false, line, input.Offset() - line_start + 1, message };
+    };
+
+    int sym = input.Peek();
+    while (sym != -1)
+    {
+        if (sym == '\n')
+        {
+            input.Advance();
+            line++;
+            line_start = input.Offset();
+        }
+
+        else if (sym == ' ' or sym == '\t' or sym == '\r')
+            input.Advance();
+
+        else if (sym == 'c' and not in_clause) // Skipping commented lines
+        {
+            while ((sym = input.Peek()) != -1 and sym != '\n')
+                input.Advance();
+        }
+
+        else if (sym == '%' and not in_clause) // SATLIB files end with '%' line followed by garbage
+            break;
+
+        else if (sym == 'p' and not in_clause) // Parsing cnf info (p cnf <variables> <clauses>)
+        {
+            if (header_presented)
+                return fail("multiple headers presented in file");
+
+            std::string header;
+            while ((sym = input.Peek()) != -1 and sym != '\n' and header.size() < 256)
+            {
+                header.push_back(sym);
+                input.Advance();
+            }
+
+            char tail = '\0';
+            if (sscanf(header.c_str(), "p cnf %u %u %c", &cnf._variables_count, &header_clauses, &tail) != 2)
+            {
+                result = { false, line, 1, "malformed header, expected 'p cnf <variables> <clauses>'" };
+                return;
+            }
+
+            header_presented = true;
+            dprintf("Readed header: %d vars and %d clauses\n", cnf._variables_count, header_clauses);
+
+            // Header is not trusted, so room is bounded by input itself: every literal takes at least two symbols.
+            // Size of streamed input is unknown, there only one chunk worth is reserved and the rest is grown on demand
+            uint64_t reserved = std::min<uint64_t>((uint64_t) header_clauses * 4, input.mapped ? input.size / 2 + 1 : _chunk_size);
+            while (capacity < reserved)
+                _grow(cnf, capacity);
+        }
+
+        else if ((sym >= '0' and sym <= '9') or sym == '-')
+        {
+            bool negative = sym == '-';
+            if (negative)
+                input.Advance();
+
+            sym = input.Peek();
+            if (sym < '0' or sym > '9')
+                return fail("expected digit after '-'");
+
+            int64_t value = 0;
+            while (sym >= '0' and sym <= '9')
+            {
+                value = value * 10 + (sym - '0');
+                if (value > INT32_MAX)
+                    return fail("literal is too big");
+
+                input.Advance();
+                sym = input.Peek();
+            }
+
+            if (sym != -1 and sym != ' ' and sym != '\t' and sym != '\r' and sym != '\n')
+                return fail("unexpected character '" + _symbol(sym) + "' after literal");
+
+            if (cnf._cnf_data_size == capacity)
+                _grow(cnf, capacity);
+
+            Literal literal = negative ? -value : value;
+            cnf._cnf_data[cnf._cnf_data_size++] = literal;
+            in_clause = literal != EmptyLiteral;
+
+            if (not in_clause)
+                cnf._clauses_count++;
+            else if ((uint32_t) value > cnf._variables_count)
+                cnf._variables_count = value;
+        }
+
+        else
+            return fail("unexpected character '" + _symbol(sym) + "'");
+
+        sym = input.Peek();
+    }
+
+    // Last clause may be not terminated by zero
+    if (in_clause)
+    {
+        if (cnf._cnf_data_size == capacity)
+            _grow(cnf, capacity);
+        cnf._cnf_data[cnf._cnf_data_size++] = EmptyLiteral;
+        cnf._clauses_count++;
+    }
+
+    if (capacity == 0)
+        _grow(cnf, capacity);
+
+    if (header_presented and cnf._clauses_count != header_clauses)
+        dprintf("Header declares %d clauses, but %d were read\n", header_clauses, cnf._clauses_count);
+}
+
+void DIMACS::_grow(CNF& cnf, uint64_t& capacity)
+{
+    uint64_t new_capacity = capacity < 1024 ? 1024 : capacity * 2;
+    Literal* data = new Literal[new_capacity];
+    if (cnf._cnf_data)
+        memcpy(data, cnf._cnf_data, cnf._cnf_data_size * sizeof(Literal));
+
+    delete[] cnf._cnf_data;
+    cnf._cnf_data = data;
+    capacity = new_capacity;
+}
+
+std::string DIMACS::_symbol(int sym)
+{
+    if (sym >= 0x20 and sym < 0x7f)
+        return std::string(1, (char) sym);
+
+    char escaped[8];
+    snprintf(escaped, sizeof(escaped), "\\x%02x", sym);
+    return escaped;
+}
+
+CNF DIMACS::ReadFromFileLegacy(const char filename[])
 {
     CNF cnf;
     
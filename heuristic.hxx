@@ -0,0 +1,316 @@
+#pragma once
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <random>
+#include "cnf.hxx"
+#include "literal.hxx"
+#include "dprintf.hxx"
+
+enum class Heuristic : uint8_t
+{
+    FIRST_LITERAL, /// First literal of first remaining clause, depends on clauses order
+    VSIDS, /// Activity of variables bumped on conflicts and decayed over time
+    JEROSLOW_WANG, /// Two-sided Jeroslow-Wang score of initial CNF
+    MOMS /// Maximum occurrences in clauses of minimum size of initial CNF
+};
+
+class Brancher
+{
+public:
+    Brancher(Heuristic heuristic, bool phase_saving, uint32_t seed);
+    Brancher(Brancher&) = delete;
+    ~Brancher();
+
+    void Init(CNF& cnf); /// Computing initial scores and filling heap with all variables
+
+    template <class Assignment>
+    Literal Pick(Assignment& assignment); /// Returning unassigned literal with best score, EmptyLiteral if all are assigned
+    Literal Polarity(Literal variable); /// Choosing sign for variable picked outside of brancher
+
+    void Bump(Literal literal); /// Increasing activity of variable which took part in conflict
+    void Decay(); /// Making all previous bumps less important
+    void Unassigned(Literal literal); /// Returning variable to heap and saving its phase
+
+    std::string Name();
+
+private:
+
+    void _insert(Literal variable);
+    Literal _pop();
+    void _siftUp(uint32_t position);
+    void _siftDown(uint32_t position);
+    bool _better(Literal a, Literal b);
+    void _free();
+
+    Heuristic _heuristic = Heuristic::FIRST_LITERAL;
+    bool _phase_saving = false;
+    uint32_t _seed = 0; /// Non-zero seed randomizes ties between scores and default polarities
+    uint32_t _variables_count = 0;
+
+    double* _scores = nullptr; /// Activity or static score of every variable
+    double _increment = 1; /// Value added to activity on bump, grows instead of decaying all activities
+    int8_t* _phases = nullptr; /// Saved phase of variable, 0 if it was never assigned
+    int8_t* _polarities = nullptr; /// Default sign chosen by heuristic
+
+    Literal* _heap = nullptr; /// Binary max-heap of variables ordered by score
+    uint32_t _heap_size = 0;
+    uint32_t* _positions = nullptr; /// Position of variable in heap, UINT32_MAX if it is not in heap
+};
+
+Brancher::Brancher(Heuristic heuristic, bool phase_saving, uint32_t seed = 0) :
+    _heuristic(heuristic), _phase_saving(phase_saving), _seed(seed) { }
+
+Brancher::~Brancher()
+{
+    _free();
+}
+
+void Brancher::_free()
+{
+    delete[] _scores;
+    delete[] _phases;
+    delete[] _polarities;
+    delete[] _heap;
+    delete[] _positions;
+
+    _scores = nullptr;
+    _phases = nullptr;
+    _polarities = nullptr;
+    _heap = nullptr;
+    _positions = nullptr;
+    _heap_size = 0;
+}
+
+void Brancher::Init(CNF& cnf)
+{
+    _free();
+
+    _variables_count = cnf._variables_count;
+    _increment = 1;
+
+    _scores = new double[_variables_count + 1] { 0 };
+    _phases = new int8_t[_variables_count + 1] { 0 };
+    _polarities = new int8_t[_variables_count + 1] { 0 };
+    _heap = new Literal[_variables_count + 1] { EmptyLiteral };
+    _positions = new uint32_t[_variables_count + 1];
+
+    // Positive and negative scores are kept separately to choose polarity
+    double* positive = new double[_variables_count + 1] { 0 };
+    double* negative = new double[_variables_count + 1] { 0 };
+
+    uint32_t min_size = UINT32_MAX;
+    if (_heuristic == Heuristic::MOMS)
+    {
+        uint32_t size = 0;
+        for (uintptr_t idx = 0; idx < cnf._cnf_data_size; idx++)
+        {
+            if (cnf._cnf_data[idx] != EmptyLiteral)
+                size++;
+            else
+            {
+                if (size >= 2 and size < min_size)
+                    min_size = size;
+                size = 0;
+            }
+        }
+    }
+
+    if (_heuristic == Heuristic::JEROSLOW_WANG or _heuristic == Heuristic::MOMS)
+    {
+        uintptr_t clause_start = 0;
+        for (uintptr_t idx = 0; idx < cnf._cnf_data_size; idx++)
+        {
+            if (cnf._cnf_data[idx] != EmptyLiteral)
+                continue;
+
+            uint32_t size = idx - clause_start;
+            double weight = _heuristic == Heuristic::JEROSLOW_WANG ? std::ldexp(1.0, -(int) size) :
+                            size == min_size ? 1 :
+                            0;
+
+            for (uintptr_t lit_idx = clause_start; lit_idx < idx; lit_idx++)
+            {
+                Literal literal = cnf._cnf_data[lit_idx];
+                (literal < 0 ? negative : positive)[abs(literal)] += weight;
+            }
+
+            clause_start = idx + 1;
+        }
+    }
+
+    std::mt19937 random(_seed);
+    std::uniform_real_distribution<double> jitter(0, 1e-3);
+
+    for (Literal variable = 1; variable <= (Literal) _variables_count; variable++)
+    {
+        switch (_heuristic)
+        {
+            case Heuristic::JEROSLOW_WANG:
+                _scores[variable] = positive[variable] + negative[variable];
+                break;
+
+            case Heuristic::MOMS:
+                _scores[variable] = (positive[variable] + negative[variable]) * 1024 + positive[variable] * negative[variable];
+                break;
+
+            default:
+                break;
+        }
+
+        // VSIDS starts from negative phase like most CDCL solvers, static scores pick the more frequent one
+        _polarities[variable] = _heuristic == Heuristic::VSIDS ? -1 :
+                                negative[variable] > positive[variable] ? -1 :
+                                1;
+
+        // Seeded brancher starts from slightly shuffled order, VSIDS one also from random phases
+        if (_seed != 0)
+        {
+            _scores[variable] += _heuristic == Heuristic::VSIDS ? jitter(random) : _scores[variable] * jitter(random);
+            if (_heuristic == Heuristic::VSIDS)
+                _polarities[variable] = random() % 2 ? 1 : -1;
+        }
+
+        _positions[variable] = UINT32_MAX;
+        _insert(variable);
+    }
+
+    delete[] positive;
+    delete[] negative;
+
+    dprintf("Brancher %s initialized for %d variables\n", Name().c_str(), _variables_count);
+}
+
+template <class Assignment>
+Literal Brancher::Pick(Assignment& assignment)
+{
+    // Variables assigned since they were inserted are dropped lazily
+    while (_heap_size > 0)
+    {
+        Literal variable = _pop();
+        if (assignment.Value(variable) == 0)
+            return Polarity(variable);
+    }
+
+    return EmptyLiteral;
+}
+
+Literal Brancher::Polarity(Literal variable)
+{
+    int8_t sign = _phase_saving and _phases[variable] != 0 ? _phases[variable] : _polarities[variable];
+    return sign < 0 ? -variable : variable;
+}
+
+void Brancher::Bump(Literal literal)
+{
+    if (_heuristic != Heuristic::VSIDS)
+        return;
+
+    Literal variable = abs(literal);
+    if ((_scores[variable] += _increment) > 1e100)
+    {
+        for (Literal other = 1; other <= (Literal) _variables_count; other++)
+            _scores[other] *= 1e-100;
+        _increment *= 1e-100;
+    }
+
+    if (_positions[variable] != UINT32_MAX)
+        _siftUp(_positions[variable]);
+}
+
+void Brancher::Decay()
+{
+    _increment /= 0.95;
+}
+
+void Brancher::Unassigned(Literal literal)
+{
+    Literal variable = abs(literal);
+    _phases[variable] = literal < 0 ? -1 : 1;
+
+    if (_positions[variable] == UINT32_MAX)
+        _insert(variable);
+}
+
+std::string Brancher::Name()
+{
+    std::string name;
+    switch (_heuristic)
+    {
+        case Heuristic::FIRST_LITERAL: name = "first-literal"; break;
+        case Heuristic::VSIDS: name = "vsids"; break;
+        case Heuristic::JEROSLOW_WANG: name = "jeroslow-wang"; break;
+        case Heuristic::MOMS: name = "moms"; break;
+    }
+
+    if (_phase_saving)
+        name += "+phase-saving";
+
+    if (_seed != 0)
+        name += "+seed-" + std::to_string(_seed);
+
+    return name;
+}
+
+void Brancher::_insert(Literal variable)
+{
+    _heap[_heap_size] = variable;
+    _positions[variable] = _heap_size;
+    _siftUp(_heap_size++);
+}
+
+Literal Brancher::_pop()
+{
+    Literal top = _heap[0];
+    _positions[top] = UINT32_MAX;
+
+    if (--_heap_size > 0)
+    {
+        _heap[0] = _heap[_heap_size];
+        _positions[_heap[0]] = 0;
+        _siftDown(0);
+    }
+
+    return top;
+}
+
+void Brancher::_siftUp(uint32_t position)
+{
+    Literal variable = _heap[position];
+    while (position > 0 and _better(variable, _heap[(position - 1) / 2]))
+    {
+        _heap[position] = _heap[(position - 1) / 2];
+        _positions[_heap[position]] = position;
+        position = (position - 1) / 2;
+    }
+
+    _heap[position] = variable;
+    _positions[variable] = position;
+}
+
+void Brancher::_siftDown(uint32_t position)
+{
+    Literal variable = _heap[position];
+    while (2 * position + 1 < _heap_size)
+    {
+        uint32_t child = 2 * position + 1;
+        if (child + 1 < _heap_size and _better(_heap[child + 1], _heap[child]))
+            child++;
+
+        if (not _better(_heap[child], variable))
+            break;
+
+        _heap[position] = _heap[child];
+        _positions[_heap[position]] = position;
+        position = child;
+    }
+
+    _heap[position] = variable;
+    _positions[variable] = position;
+}
+
+bool Brancher::_better(Literal a, Literal b)
+{
+    // Ties are broken by variable number to keep order deterministic
+    return _scores[a] > _scores[b] or (_scores[a] == _scores[b] and a < b);
+}
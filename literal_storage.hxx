@@ -1,5 +1,7 @@
 #pragma once
 #include <cstdint>
+#include <cstdlib>
+#include <vector>
 #include "literal.hxx"
 #include "dprintf.hxx"
 
@@ -23,13 +25,27 @@ public:
     bool Pure(Literal literal);
     int PureCount();
 
+    void Add(Literal literal); /// Counting one more occurrence of literal
+    void Remove(Literal literal); /// Forgetting one occurrence of literal, collecting variable if it became pure
+    uint32_t Occurrences(Literal literal);
+
+    void CollectPure(); /// Putting all currently pure literals to worklist
+    Literal PopPure(); /// Returning literal which is still pure from worklist, EmptyLiteral if there are none
+    void ClearPure();
+
 private:
 
+    bool _setUsage(Literal literal, bool used); /// Updating usage bit of literal, returning true if variable became pure
+    static uint32_t _index(Literal literal);
+
     int _size = 0;
     int _usage_data_bytes_size = 0;
     byte* _usage_data = nullptr;
 
     int _pure_count = 0;
+
+    uint32_t* _occurrences = nullptr; /// Occurrences count of every literal, indexed by _index(literal)
+    std::vector<Literal> _became_pure; /// Worklist of literals which became pure, may contain outdated ones
 };
 
 LiteralStorage::LiteralStorage() { }
@@ -44,6 +60,7 @@ LiteralStorage::~LiteralStorage()
     if (_usage_data)
     {
         delete[] _usage_data;
+        delete[] _occurrences;
         _usage_data_bytes_size = 0;
         _size = 0;
     }
@@ -51,9 +68,15 @@ LiteralStorage::~LiteralStorage()
 
 void LiteralStorage::Allocate(int size)
 {
+    delete[] _usage_data;
+    delete[] _occurrences;
+
     _size = size;
     _usage_data_bytes_size = _size / capacityof(byte) + ((size % capacityof(byte)) == 0 ? 0 : 1);
     _usage_data = new byte[_usage_data_bytes_size] { 0 };
+    _occurrences = new uint32_t[2 * (_size + 1)] { 0 };
+    _pure_count = 0;
+    _became_pure.clear();
 }
 
 void LiteralStorage::Reset()
@@ -61,9 +84,17 @@ void LiteralStorage::Reset()
     _pure_count = 0;
     for (int i = 0; i < _usage_data_bytes_size; i++)
         _usage_data[i] = (byte) 0b00000000u;
+    for (int i = 0; i < 2 * (_size + 1); i++)
+        _occurrences[i] = 0;
+    _became_pure.clear();
 }
 
 void LiteralStorage::SetUsage(Literal literal)
+{
+    _setUsage(literal, true);
+}
+
+bool LiteralStorage::_setUsage(Literal literal, bool used)
 {
     bool negative = literal < 0;
     Literal original_literal = negative ? -literal : literal;
@@ -75,7 +106,7 @@ void LiteralStorage::SetUsage(Literal literal)
     byte flag_mask = negative ? 0b01010101 : 0b10101010;
 
     byte old_elem = _usage_data[data_idx];
-    byte new_elem = old_elem | (elem_mask & flag_mask);
+    byte new_elem = used ? old_elem | (elem_mask & flag_mask) : old_elem & ~(elem_mask & flag_mask);
     _usage_data[data_idx] = new_elem;
 
     byte old_usage = (old_elem & elem_mask) >> shift;
@@ -87,6 +118,8 @@ void LiteralStorage::SetUsage(Literal literal)
     _pure_count += (was_pure and not is_pure) ? -1 :
                    (not was_pure and is_pure) ? 1 :
                    0;
+
+    return not was_pure and is_pure;
 }
 
 byte LiteralStorage::GetUsage(Literal literal)
@@ -113,3 +146,52 @@ int LiteralStorage::PureCount()
 {
     return _pure_count;
 }
+
+void LiteralStorage::Add(Literal literal)
+{
+    if (_occurrences[_index(literal)]++ == 0)
+        _setUsage(literal, true);
+}
+
+void LiteralStorage::Remove(Literal literal)
+{
+    // Only last occurrence changes usage, and then the opposite literal may become pure
+    if (--_occurrences[_index(literal)] == 0 and _setUsage(literal, false))
+        _became_pure.push_back(-literal);
+}
+
+uint32_t LiteralStorage::Occurrences(Literal literal)
+{
+    return _occurrences[_index(literal)];
+}
+
+void LiteralStorage::CollectPure()
+{
+    for (Literal variable = 1; variable <= _size; variable++)
+        if (Pure(variable))
+            _became_pure.push_back(_occurrences[_index(variable)] > 0 ? variable : -variable);
+}
+
+Literal LiteralStorage::PopPure()
+{
+    while (not _became_pure.empty())
+    {
+        Literal literal = _became_pure.back();
+        _became_pure.pop_back();
+
+        if (_occurrences[_index(literal)] > 0 and _occurrences[_index(-literal)] == 0)
+            return literal;
+    }
+
+    return EmptyLiteral;
+}
+
+void LiteralStorage::ClearPure()
+{
+    _became_pure.clear();
+}
+
+uint32_t LiteralStorage::_index(Literal literal)
+{
+    return literal < 0 ? 2 * (-literal) + 1 : 2 * literal;
+}
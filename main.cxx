@@ -1,26 +1,165 @@
 #include "solver.hxx"
+#include "portfolio.hxx"
+#include "cube_and_conquer.hxx"
 #include "dprintf.hxx"
 #include "dimacs.hxx"
 #include "cnf.hxx"
+#include "batch.hxx"
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
 
 int main(int argc, char** argv)
 {
     if (argc == 1)
-        dprintf("Filename isn't provided!\nUsage: %s [filename, ..]\n", argv[0]);
+        dprintf("Filename isn't provided!\nUsage: %s [-j threads] [--cubes depth] [--preprocess] [--model] [--stats file] [filename, ..]\n"
+                "       %s --batch list [-j threads] [--cubes depth] [--preprocess] [--jobs count] [--timeout seconds] [--memory megabytes] [--stats file]\n", argv[0], argv[0]);
+
+    // Preprocessing is off by default, it makes random CNFs slower and pays off on structured ones only
+    Rule rules = Rule::REMOVE_SINGULAR | Rule::WATCHED_LITERALS | Rule::CONFLICT_LEARNING | Rule::PHASE_SAVING;
+    const Heuristic heuristic = Heuristic::VSIDS;
 
     int err_count = 0;
-    auto solver = Solver(Rule::REMOVE_SINGULAR);
+    uint32_t threads = 1; // 0 means all available cores
+    int cube_depth = -1; // Cube and conquer is used instead of portfolio if depth is set
+    bool print_model = false;
+    FILE* stats = nullptr; // JSON report of every instance is printed here if set, batch prints it to stderr by default
+
+    std::vector<std::string> batch_files; // Instances solved by batch after all arguments are processed
+    bool batch = false;
+    Batch::Limits limits;
 
     for (int f_no = 1; f_no < argc; f_no++)
     {
-        CNF cnf = DIMACS::ReadFromFile(argv[f_no]);
+        if (strcmp(argv[f_no], "-j") == 0 or strcmp(argv[f_no], "--threads") == 0)
+        {
+            if (f_no + 1 == argc)
+            {
+                fprintf(stderr, "%s requires number of threads\n", argv[f_no]);
+                return 1;
+            }
+            threads = atoi(argv[++f_no]);
+            continue;
+        }
+
+        if (strcmp(argv[f_no], "--cubes") == 0)
+        {
+            if (f_no + 1 == argc)
+            {
+                fprintf(stderr, "%s requires depth of splitting\n", argv[f_no]);
+                return 1;
+            }
+            cube_depth = atoi(argv[++f_no]);
+            continue;
+        }
+
+        if (strncmp(argv[f_no], "-j", 2) == 0 and argv[f_no][2] != '\0')
+        {
+            threads = atoi(argv[f_no] + 2);
+            continue;
+        }
+
+        if (strcmp(argv[f_no], "--model") == 0)
+        {
+            print_model = true;
+            continue;
+        }
+
+        if (strcmp(argv[f_no], "--preprocess") == 0)
+        {
+            rules = rules | Rule::PREPROCESSING;
+            continue;
+        }
+
+        if (strcmp(argv[f_no], "--stats") == 0 or strcmp(argv[f_no], "--batch") == 0 or strcmp(argv[f_no], "--jobs") == 0 or
+            strcmp(argv[f_no], "--timeout") == 0 or strcmp(argv[f_no], "--memory") == 0)
+        {
+            if (f_no + 1 == argc)
+            {
+                fprintf(stderr, "%s requires value\n", argv[f_no]);
+                return 1;
+            }
+
+            const char* option = argv[f_no];
+            const char* value = argv[++f_no];
+
+            if (strcmp(option, "--batch") == 0)
+            {
+                batch = true;
+                if (not Batch::ReadList(value, batch_files))
+                    err_count++;
+            }
+            else if (strcmp(option, "--jobs") == 0)
+                limits.jobs = atoi(value);
+            else if (strcmp(option, "--timeout") == 0)
+                limits.seconds = atof(value);
+            else if (strcmp(option, "--memory") == 0)
+                limits.memory_mb = atoll(value);
+            else
+            {
+                if (stats and stats != stdout)
+                    fclose(stats);
+                stats = strcmp(value, "-") == 0 ? stdout : fopen(value, "w");
+                if (not stats)
+                {
+                    perror(value);
+                    return 1;
+                }
+            }
+            continue;
+        }
+
+        rusage started_usage {};
+        getrusage(RUSAGE_SELF, &started_usage);
+        auto start = std::chrono::steady_clock::now();
+        DIMACS::ParseResult parsed;
+        CNF cnf = DIMACS::ReadFromFile(argv[f_no], &parsed);
+        auto parsed_at = std::chrono::steady_clock::now();
+
+        if (not parsed.ok)
+        {
+            fprintf(stderr, "%s:%lu:%lu: %s\n", argv[f_no], parsed.line, parsed.column, parsed.message.c_str());
+            printf("ERROR\n");
+            err_count++;
+            continue;
+        }
 
         dprintf("Loaded %s\nCNF consist of %d clauses\n%s\n", argv[f_no], cnf.ClausesCount(), cnf.ToString().c_str());
         
-        auto result = solver.Solve(cnf);
+        Solver::Status result = Solver::Status::UNKNOWN;
+        Solver::Statistics counters;
+        std::vector<Literal> model;
 
-        dprintf("Solved in %d steps (out of 2^%d)\n", solver.Complexity(), cnf.VariablesCount());
+        if (cube_depth >= 0)
+        {
+            CubeAndConquer cube_and_conquer(threads, cube_depth, rules, heuristic);
+            result = cube_and_conquer.Solve(cnf);
+            counters = cube_and_conquer.Stats();
+            model.swap(cube_and_conquer.Model());
+            dprintf("Solved in %d steps (out of 2^%d) from %d cubes, %d stolen\n", cube_and_conquer.Complexity(), cnf.VariablesCount(), cube_and_conquer.CubesCount(), cube_and_conquer.Stolen());
+        }
+        else if (threads == 1)
+        {
+            Solver solver(rules, heuristic);
+            result = solver.Solve(cnf);
+            counters = solver.Stats();
+            model.swap(solver.Model());
+            if ((rules & Rule::PREPROCESSING) != Rule::NONE)
+                dprintf("Preprocessing left %d of %d clauses, %d variables eliminated\n", solver.PreprocessingStats().clauses_after, solver.PreprocessingStats().clauses_before, solver.PreprocessingStats().eliminated_variables);
+            dprintf("Solved in %d steps (out of 2^%d) branching by %s\n", solver.Complexity(), cnf.VariablesCount(), solver.Branching().c_str());
+        }
+        else
+        {
+            Portfolio portfolio(threads);
+            result = portfolio.Solve(cnf);
+            counters = portfolio.Stats();
+            model.swap(portfolio.Model());
+            dprintf("Solved in %d steps (out of 2^%d) by %s\n", portfolio.Complexity(), cnf.VariablesCount(), portfolio.Winner().c_str());
+        }
         
         switch (result)
         {
@@ -33,7 +172,43 @@ int main(int argc, char** argv)
             default:
                 printf("Unreachable");
         }
+
+        if (print_model and result == Solver::Status::SAT)
+            Batch::PrintModel(stdout, model);
+
+        if (stats)
+        {
+            auto finished_at = std::chrono::steady_clock::now();
+            rusage usage {};
+            getrusage(RUSAGE_SELF, &usage);
+
+            // Peak memory is the one of whole process, so it never decreases between instances
+            Batch::Report report;
+            report.status = result;
+            report.variables = cnf.VariablesCount();
+            report.clauses = cnf.ClausesCount();
+            report.parse_seconds = std::chrono::duration<double>(parsed_at - start).count();
+            report.solve_seconds = std::chrono::duration<double>(finished_at - parsed_at).count();
+            report.wall_seconds = std::chrono::duration<double>(finished_at - start).count();
+            report.cpu_seconds = Batch::CpuSeconds(usage) - Batch::CpuSeconds(started_usage);
+            report.decisions = counters.decisions;
+            report.propagations = counters.propagations;
+            report.conflicts = counters.conflicts;
+            report.peak_memory_kb = usage.ru_maxrss;
+            Batch::PrintStats(stats, argv[f_no], report);
+        }
     }
 
+    if (batch)
+    {
+        // Reports are kept away from stdout by default, so it holds answers in competition format only
+        Batch runner(limits, rules, heuristic, threads, cube_depth);
+        if (not runner.Run(batch_files, stats ? stats : stderr))
+            err_count++;
+    }
+
+    if (stats and stats != stdout)
+        fclose(stats);
+
     return err_count != 0;
 }
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "solver.hxx"
+#include "clause_exchange.hxx"
+#include "threads.hxx"
+#include "cnf.hxx"
+#include "rules.hxx"
+#include "heuristic.hxx"
+#include "dprintf.hxx"
+
+/// Running differently configured solvers on the same CNF in parallel threads.
+/// First solver which finds the answer stops all others, CDCL solvers share short learned clauses
+class Portfolio
+{
+public:
+
+    Portfolio(uint32_t threads);
+    Portfolio(Portfolio&) = delete;
+
+    Solver::Status Solve(CNF& cnf);
+    void StopOn(const std::atomic<bool>* stop); /// Making Solve return UNKNOWN as soon as flag is raised
+
+    uint64_t Complexity(); /// Complexity of solver which found the answer
+    const Solver::Statistics& Stats(); /// Counters of solver which found the answer, zero if nobody did
+    std::string Winner(); /// Configuration of solver which found the answer
+    std::vector<Literal>& Model(); /// Model found by winner if answer is SAT
+
+private:
+
+    struct Configuration
+    {
+        Rule rules;
+        Heuristic heuristic;
+        uint32_t seed;
+    };
+
+    static Configuration _configuration(uint32_t idx); /// Configuration of idx-th thread, first one is the same as single threaded solver
+
+    uint32_t _threads = 1;
+    const std::atomic<bool>* _stop = nullptr;
+    uint64_t _complexity = 0;
+    Solver::Statistics _stats;
+    std::string _winner;
+    std::vector<Literal> _model;
+};
+
+Portfolio::Portfolio(uint32_t threads) : _threads(threads == 0 ? AvailableThreads() : threads) { }
+
+Portfolio::Configuration Portfolio::_configuration(uint32_t idx)
+{
+    const Rule cdcl = Rule::REMOVE_SINGULAR | Rule::WATCHED_LITERALS | Rule::CONFLICT_LEARNING;
+
+    switch (idx)
+    {
+        case 0: return { cdcl | Rule::PHASE_SAVING, Heuristic::VSIDS, 0 };
+        case 1: return { cdcl | Rule::PHASE_SAVING, Heuristic::VSIDS, 1 };
+        case 2: return { cdcl | Rule::PHASE_SAVING, Heuristic::JEROSLOW_WANG, 0 };
+        case 3: return { cdcl, Heuristic::VSIDS, 3 };
+        case 4: return { cdcl | Rule::PREPROCESSING | Rule::PHASE_SAVING, Heuristic::MOMS, 0 }; // Only thread which preprocesses, it pays off on structured CNFs only
+        case 5: return { Rule::REMOVE_SINGULAR | Rule::WATCHED_LITERALS, Heuristic::JEROSLOW_WANG, 0 };
+        default: return { cdcl | (idx % 2 ? Rule::NONE : Rule::PHASE_SAVING), Heuristic::VSIDS, idx };
+    }
+}
+
+Solver::Status Portfolio::Solve(CNF& cnf)
+{
+    // Nothing of previous call is reported if nobody finds the answer
+    _complexity = 0;
+    _stats = Solver::Statistics();
+    _winner.clear();
+    _model.clear();
+
+    std::atomic<bool> stop { false };
+    std::atomic<int> winner { -1 };
+    std::atomic<uint32_t> running { _threads };
+    ClauseExchange exchange;
+
+    std::vector<Solver*> solvers;
+    std::vector<Solver::Status> results(_threads, Solver::Status::UNKNOWN);
+    std::vector<std::thread> threads;
+
+    // Every thread gets its own copy, so shared CNF is never touched concurrently
+    CNF* copies = new CNF[_threads];
+
+    for (uint32_t idx = 0; idx < _threads; idx++)
+    {
+        Configuration configuration = _configuration(idx);
+        Solver* solver = new Solver(configuration.rules, configuration.heuristic, configuration.seed);
+        solver->StopOn(&stop);
+        solver->ShareClauses(&exchange, idx);
+        solvers.push_back(solver);
+        copies[idx] = cnf;
+    }
+
+    for (uint32_t idx = 0; idx < _threads; idx++)
+    {
+        threads.emplace_back([&, idx]()
+        {
+            results[idx] = solvers[idx]->Solve(copies[idx]);
+
+            int nobody = -1;
+            if (results[idx] != Solver::Status::UNKNOWN and winner.compare_exchange_strong(nobody, idx))
+                stop.store(true);
+            running--;
+        });
+    }
+
+    JoinThreads(threads, running, _stop, [&stop]() { stop.store(true); });
+
+    Solver::Status result = Solver::Status::UNKNOWN;
+    if (winner >= 0)
+    {
+        result = results[winner];
+        _complexity = solvers[winner]->Complexity();
+        _stats = solvers[winner]->Stats();
+        _model.swap(solvers[winner]->Model());
+        _winner = "thread " + std::to_string(winner) + " (" + solvers[winner]->Branching() + ")";
+    }
+
+    dprintf("Portfolio of %d threads finished, winner is %s, %lu clauses shared\n", _threads, _winner.c_str(), exchange.Exported());
+
+    for (Solver* solver : solvers)
+        delete solver;
+    delete[] copies;
+
+    return result;
+}
+
+void Portfolio::StopOn(const std::atomic<bool>* stop)
+{
+    _stop = stop;
+}
+
+uint64_t Portfolio::Complexity()
+{
+    return _complexity;
+}
+
+const Solver::Statistics& Portfolio::Stats()
+{
+    return _stats;
+}
+
+std::string Portfolio::Winner()
+{
+    return _winner;
+}
+
+std::vector<Literal>& Portfolio::Model()
+{
+    return _model;
+}
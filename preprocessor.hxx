@@ -0,0 +1,711 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "cnf.hxx"
+#include "literal.hxx"
+#include "dprintf.hxx"
+
+/// Simplifying CNF before search: removing tautologies and duplicate literals,
+/// subsumption, self-subsuming strengthening, bounded variable elimination and
+/// failed literal probing. Simplified CNF is equisatisfiable with the original one,
+/// its models are turned into models of original CNF by Extend
+class Preprocessor
+{
+public:
+
+    struct Limits
+    {
+        double seconds = 5; /// Wall time of all passes together
+        uint64_t subsumption_steps = 50000000; /// Literal comparisons in subsumption and strengthening
+        uint64_t elimination_steps = 50000000; /// Literals visited while building resolvents
+        uint32_t elimination_occurrences = 16; /// Variables occurring in more clauses are never eliminated
+        uint32_t resolvent_size = 24; /// Variable is not eliminated if some resolvent would be longer
+        uint64_t probes = 20000; /// Literals checked by failed literal probing
+        uint32_t probing_clauses = 1000000; /// Variable elimination and probing are skipped on CNFs with more clauses
+    };
+
+    struct Statistics
+    {
+        uint32_t clauses_before = 0;
+        uint32_t clauses_after = 0;
+        uint32_t tautologies = 0;
+        uint32_t duplicate_literals = 0;
+        uint32_t units = 0;
+        uint32_t subsumed = 0;
+        uint32_t strengthened = 0;
+        uint32_t eliminated_variables = 0;
+        uint32_t resolvents = 0;
+        uint32_t failed_literals = 0;
+        double seconds = 0;
+    };
+
+    Preprocessor();
+    Preprocessor(Preprocessor&) = delete;
+    ~Preprocessor();
+
+    CNF::ActionResult Simplify(CNF& cnf); /// Replacing clauses of cnf with simplified ones, cnf is left unprepared; EMPTY_CLAUSE_CREATED means it is UNSAT
+    void Extend(std::vector<Literal>& model); /// Turning model of simplified CNF (model[var - 1] is literal of var) into model of original one
+
+    void SetLimits(const Limits& limits);
+    void StopOn(const std::atomic<bool>* stop); /// Making Simplify give up as soon as flag is raised, as if time was over
+    const Statistics& Stats();
+
+private:
+
+    struct Clause
+    {
+        std::vector<Literal> literals; /// Sorted by variable
+        uint64_t signature = 0; /// Bit (variable % 64) is set for every variable of clause
+        bool removed = false;
+        bool queued = false; /// Clause waits in subsumption queue
+    };
+
+    static uint32_t _index(Literal literal);
+    static bool _byVariable(Literal a, Literal b);
+    static uint64_t _signature(std::vector<Literal>& literals);
+    static bool _subset(std::vector<Literal>& small, std::vector<Literal>& big, Literal& flipped, uint64_t& steps); /// Checking if small is in big with at most one literal flipped
+
+    bool _expired(); /// Checking time limit and stop flag
+    int8_t _value(Literal literal);
+
+    bool _load(CNF& cnf); /// Returning false if time was over before all clauses were loaded
+    void _store(CNF& cnf);
+    bool _changed(); /// Checking if some clause was removed or changed since loading
+    bool _addClause(std::vector<Literal>& literals); /// Adding sorted clause without duplicates, returning false if it is empty
+    void _removeClause(uint32_t clause);
+    bool _removeLiteral(uint32_t clause, Literal literal); /// Strengthening clause, returning false if it became empty
+    void _pushReconstruction(std::vector<Literal>& literals, Literal pivot);
+
+    bool _propagate(); /// Fixing units found so far, returning false on conflict
+    bool _subsumeAll(); /// Backward subsumption and strengthening with every queued clause
+    bool _subsume(uint32_t clause);
+    void _enqueue(uint32_t clause);
+    bool _eliminateAll();
+    bool _eliminate(Literal variable); /// Replacing clauses of variable with their resolvents if it doesn't grow CNF
+    bool _resolve(std::vector<Literal>& positive, std::vector<Literal>& negative, Literal variable, std::vector<Literal>& resolvent); /// Returning false if resolvent is tautology
+    bool _probe(CNF& cnf); /// Failed literal probing on CNF built from remaining clauses
+
+    Limits _limits;
+    Statistics _stats;
+    std::chrono::steady_clock::time_point _deadline;
+    const std::atomic<bool>* _stop = nullptr;
+
+    uint32_t _variables_count = 0;
+    std::vector<Clause> _clauses;
+    std::vector<uint32_t>* _occurrences = nullptr; /// Live clauses containing literal, indexed by _index(literal)
+    int8_t* _values = nullptr; /// Values of variables fixed by units
+    bool* _eliminated = nullptr;
+
+    std::vector<Literal> _units; /// Units waiting to be fixed
+    std::vector<uint32_t> _queue; /// Clauses to subsume others with
+    bool _empty = false; /// Empty clause was met
+    uint64_t _subsumption_steps = 0;
+    uint64_t _elimination_steps = 0;
+
+    std::vector<Literal> _reconstruction; /// Removed clauses as [pivot, other literals..., size], pivot is made true if clause is false in model
+};
+
+Preprocessor::Preprocessor() { }
+
+Preprocessor::~Preprocessor()
+{
+    delete[] _occurrences;
+    delete[] _values;
+    delete[] _eliminated;
+}
+
+void Preprocessor::SetLimits(const Limits& limits)
+{
+    _limits = limits;
+}
+
+void Preprocessor::StopOn(const std::atomic<bool>* stop)
+{
+    _stop = stop;
+}
+
+const Preprocessor::Statistics& Preprocessor::Stats()
+{
+    return _stats;
+}
+
+uint32_t Preprocessor::_index(Literal literal)
+{
+    return literal < 0 ? 2 * (-literal) + 1 : 2 * literal;
+}
+
+bool Preprocessor::_byVariable(Literal a, Literal b)
+{
+    return abs(a) < abs(b) or (abs(a) == abs(b) and a < b);
+}
+
+uint64_t Preprocessor::_signature(std::vector<Literal>& literals)
+{
+    uint64_t signature = 0;
+    for (Literal literal : literals)
+        signature |= 1ull << (abs(literal) % 64);
+    return signature;
+}
+
+bool Preprocessor::_subset(std::vector<Literal>& small, std::vector<Literal>& big, Literal& flipped, uint64_t& steps)
+{
+    flipped = EmptyLiteral;
+
+    // Both clauses are sorted by variable, so they are merged in one pass
+    uintptr_t big_idx = 0;
+    for (Literal literal : small)
+    {
+        while (big_idx < big.size() and abs(big[big_idx]) < abs(literal))
+            big_idx++;
+
+        steps += big_idx;
+        if (big_idx == big.size() or abs(big[big_idx]) != abs(literal))
+            return false;
+
+        if (big[big_idx] != literal)
+        {
+            if (flipped != EmptyLiteral)
+                return false;
+            flipped = literal;
+        }
+
+        big_idx++;
+    }
+
+    return true;
+}
+
+bool Preprocessor::_expired()
+{
+    return (_stop and _stop->load(std::memory_order_relaxed)) or std::chrono::steady_clock::now() > _deadline;
+}
+
+bool Preprocessor::_changed()
+{
+    return not _reconstruction.empty() or _stats.tautologies != 0 or _stats.duplicate_literals != 0 or
+           _stats.subsumed != 0 or _stats.strengthened != 0;
+}
+
+int8_t Preprocessor::_value(Literal literal)
+{
+    int8_t value = _values[abs(literal)];
+    return literal < 0 ? -value : value;
+}
+
+CNF::ActionResult Preprocessor::Simplify(CNF& cnf)
+{
+    auto start = std::chrono::steady_clock::now();
+    _deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(_limits.seconds));
+    _stats = Statistics();
+    _empty = false;
+    _subsumption_steps = 0;
+    _elimination_steps = 0;
+
+    // Given up loading leaves cnf as it was, nothing has to be reconstructed then
+    if (not _load(cnf))
+    {
+        dprintf("Preprocessing gave up on loading after %u clauses\n", _stats.clauses_before);
+        _reconstruction.clear();
+        _stats.clauses_after = cnf._clauses_count;
+        _stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return CNF::ActionResult::OK;
+    }
+
+    bool small = _stats.clauses_before <= _limits.probing_clauses;
+    bool consistent = not _empty and _propagate() and _subsumeAll() and (not small or _eliminateAll());
+    if (consistent)
+    {
+        // Rewriting cnf costs as much as loading it, so unchanged cnf is kept
+        if (_changed())
+            _store(cnf);
+        if (small and not _expired())
+            consistent = _probe(cnf);
+    }
+
+    _stats.clauses_after = consistent ? cnf._clauses_count : 0;
+    _stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    dprintf("Preprocessed %u clauses into %u in %.3f s: %u tautologies, %u duplicate literals, %u units, %u subsumed, %u strengthened, "
+            "%u variables eliminated with %u resolvents, %u failed literals\n",
+            _stats.clauses_before, _stats.clauses_after, _stats.seconds, _stats.tautologies, _stats.duplicate_literals, _stats.units,
+            _stats.subsumed, _stats.strengthened, _stats.eliminated_variables, _stats.resolvents, _stats.failed_literals);
+
+    if (not consistent)
+        return CNF::ActionResult::EMPTY_CLAUSE_CREATED;
+    return cnf._clauses_count == 0 ? CNF::ActionResult::CNF_DEVASTED : CNF::ActionResult::OK;
+}
+
+bool Preprocessor::_load(CNF& cnf)
+{
+    // Assignments of CNF in the middle of search are dropped by copying its remaining part
+    CNF remaining(cnf);
+
+    _variables_count = remaining._variables_count;
+    for (uintptr_t idx = 0; idx < remaining._cnf_data_size; idx++)
+        if ((uint32_t) abs(remaining._cnf_data[idx]) > _variables_count)
+            _variables_count = abs(remaining._cnf_data[idx]);
+
+    delete[] _occurrences;
+    delete[] _values;
+    delete[] _eliminated;
+
+    _occurrences = new std::vector<uint32_t>[2 * (_variables_count + 1)];
+    _values = new int8_t[_variables_count + 1] { 0 };
+    _eliminated = new bool[_variables_count + 1] { false };
+    _clauses.clear();
+    _units.clear();
+    _queue.clear();
+    _reconstruction.clear();
+
+    std::vector<Literal> literals;
+    for (uintptr_t idx = 0; idx < remaining._cnf_data_size; idx++)
+    {
+        if (remaining._cnf_data[idx] != EmptyLiteral)
+        {
+            literals.push_back(remaining._cnf_data[idx]);
+            continue;
+        }
+
+        _stats.clauses_before++;
+        if (_stats.clauses_before % 4096 == 0 and _expired())
+            return false;
+
+        std::sort(literals.begin(), literals.end(), _byVariable);
+
+        bool tautology = false;
+        uintptr_t kept = 0;
+        for (uintptr_t lit_idx = 0; lit_idx < literals.size(); lit_idx++)
+        {
+            if (kept > 0 and literals[kept - 1] == literals[lit_idx])
+                _stats.duplicate_literals++;
+            else if (kept > 0 and literals[kept - 1] == -literals[lit_idx])
+                tautology = true;
+            else
+                literals[kept++] = literals[lit_idx];
+        }
+        literals.resize(kept);
+
+        if (tautology)
+            _stats.tautologies++;
+        else if (not _addClause(literals))
+            _empty = true;
+
+        literals.clear();
+    }
+
+    return true;
+}
+
+void Preprocessor::_store(CNF& cnf)
+{
+    std::vector<Literal> data;
+    uint32_t clauses_count = 0;
+    for (Clause& clause : _clauses)
+    {
+        if (clause.removed)
+            continue;
+
+        data.insert(data.end(), clause.literals.begin(), clause.literals.end());
+        data.push_back(EmptyLiteral);
+        clauses_count++;
+    }
+
+    cnf._free();
+    cnf._cnf_data_size = data.size();
+    cnf._cnf_data = new Literal[data.size()];
+    if (not data.empty())
+        memcpy(cnf._cnf_data, data.data(), data.size() * sizeof(Literal));
+    cnf._clauses_count = clauses_count;
+    cnf._variables_count = _variables_count;
+}
+
+bool Preprocessor::_addClause(std::vector<Literal>& literals)
+{
+    if (literals.empty())
+        return false;
+
+    uint32_t clause = _clauses.size();
+    _clauses.emplace_back();
+    _clauses[clause].literals = literals;
+    _clauses[clause].signature = _signature(literals);
+
+    for (Literal literal : literals)
+        _occurrences[_index(literal)].push_back(clause);
+
+    if (literals.size() == 1)
+        _units.push_back(literals[0]);
+
+    _enqueue(clause);
+    return true;
+}
+
+void Preprocessor::_removeClause(uint32_t clause)
+{
+    _clauses[clause].removed = true;
+
+    for (Literal literal : _clauses[clause].literals)
+    {
+        std::vector<uint32_t>& occurrences = _occurrences[_index(literal)];
+        auto position = std::find(occurrences.begin(), occurrences.end(), clause);
+        *position = occurrences.back();
+        occurrences.pop_back();
+    }
+}
+
+bool Preprocessor::_removeLiteral(uint32_t clause, Literal literal)
+{
+    std::vector<Literal>& literals = _clauses[clause].literals;
+    literals.erase(std::find(literals.begin(), literals.end(), literal));
+    _clauses[clause].signature = _signature(literals);
+
+    std::vector<uint32_t>& occurrences = _occurrences[_index(literal)];
+    auto position = std::find(occurrences.begin(), occurrences.end(), clause);
+    *position = occurrences.back();
+    occurrences.pop_back();
+
+    if (literals.empty())
+        return false;
+
+    if (literals.size() == 1)
+        _units.push_back(literals[0]);
+
+    // Shorter clause may subsume clauses which previous version didn't
+    _enqueue(clause);
+    return true;
+}
+
+void Preprocessor::_enqueue(uint32_t clause)
+{
+    if (_clauses[clause].queued)
+        return;
+
+    _clauses[clause].queued = true;
+    _queue.push_back(clause);
+}
+
+void Preprocessor::_pushReconstruction(std::vector<Literal>& literals, Literal pivot)
+{
+    _reconstruction.push_back(pivot);
+    for (Literal literal : literals)
+        if (literal != pivot)
+            _reconstruction.push_back(literal);
+    _reconstruction.push_back(literals.size());
+}
+
+bool Preprocessor::_propagate()
+{
+    std::vector<Literal> unit(1);
+    while (not _units.empty())
+    {
+        Literal literal = _units.back();
+        _units.pop_back();
+
+        if (_value(literal) == 1)
+            continue;
+        if (_value(literal) == -1)
+            return false;
+
+        _values[abs(literal)] = literal < 0 ? -1 : 1;
+        _stats.units++;
+
+        unit[0] = literal;
+        _pushReconstruction(unit, literal);
+
+        // Lists are copied because removing clauses edits them
+        std::vector<uint32_t> satisfied = _occurrences[_index(literal)];
+        for (uint32_t clause : satisfied)
+            _removeClause(clause);
+
+        std::vector<uint32_t> strengthened = _occurrences[_index(-literal)];
+        for (uint32_t clause : strengthened)
+            if (not _removeLiteral(clause, -literal))
+                return false;
+    }
+
+    return true;
+}
+
+bool Preprocessor::_subsumeAll()
+{
+    // Queue is processed from the back, so short clauses go first
+    std::sort(_queue.begin(), _queue.end(), [this](uint32_t a, uint32_t b)
+    {
+        return _clauses[a].literals.size() > _clauses[b].literals.size();
+    });
+
+    while (not _queue.empty())
+    {
+        if (_subsumption_steps > _limits.subsumption_steps or _expired())
+        {
+            dprintf("Subsumption stopped after %lu steps\n", _subsumption_steps);
+            for (uint32_t clause : _queue)
+                _clauses[clause].queued = false;
+            _queue.clear();
+            break;
+        }
+
+        uint32_t clause = _queue.back();
+        _queue.pop_back();
+        _clauses[clause].queued = false;
+
+        if (_clauses[clause].removed)
+            continue;
+
+        if (not _subsume(clause) or not _propagate())
+            return false;
+    }
+
+    return true;
+}
+
+bool Preprocessor::_subsume(uint32_t clause)
+{
+    // Every clause subsumed or strengthened by this one contains its rarest variable
+    Literal best = EmptyLiteral;
+    uintptr_t best_count = SIZE_MAX;
+    for (Literal literal : _clauses[clause].literals)
+    {
+        uintptr_t count = _occurrences[_index(literal)].size() + _occurrences[_index(-literal)].size();
+        if (count < best_count)
+        {
+            best = literal;
+            best_count = count;
+        }
+    }
+
+    for (Literal literal : { best, -best })
+    {
+        std::vector<uint32_t> candidates = _occurrences[_index(literal)];
+        for (uint32_t other : candidates)
+        {
+            Clause& small = _clauses[clause];
+            Clause& big = _clauses[other];
+            if (other == clause or big.removed or big.literals.size() < small.literals.size() or
+                (small.signature & ~big.signature) != 0)
+                continue;
+
+            Literal flipped = EmptyLiteral;
+            if (not _subset(small.literals, big.literals, flipped, _subsumption_steps))
+                continue;
+
+            if (flipped == EmptyLiteral)
+            {
+                _removeClause(other);
+                _stats.subsumed++;
+            }
+            else
+            {
+                // Resolving both clauses on flipped gives other clause without its -flipped
+                _stats.strengthened++;
+                if (not _removeLiteral(other, -flipped))
+                    return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Preprocessor::_eliminateAll()
+{
+    // Variables with few occurrences are cheaper to eliminate, so they go first
+    std::vector<Literal> variables;
+    for (Literal variable = 1; variable <= (Literal) _variables_count; variable++)
+        if (_values[variable] == 0)
+            variables.push_back(variable);
+
+    auto cost = [this](Literal variable)
+    {
+        return (uint64_t) _occurrences[_index(variable)].size() * _occurrences[_index(-variable)].size();
+    };
+    std::stable_sort(variables.begin(), variables.end(), [&](Literal a, Literal b) { return cost(a) < cost(b); });
+
+    for (Literal variable : variables)
+    {
+        if (_elimination_steps > _limits.elimination_steps or _expired())
+        {
+            dprintf("Variable elimination stopped after %lu steps\n", _elimination_steps);
+            break;
+        }
+
+        if (_values[variable] != 0 or _eliminated[variable])
+            continue;
+
+        if (not _eliminate(variable) or not _propagate() or not _subsumeAll())
+            return false;
+    }
+
+    return true;
+}
+
+bool Preprocessor::_eliminate(Literal variable)
+{
+    std::vector<uint32_t> positive = _occurrences[_index(variable)];
+    std::vector<uint32_t> negative = _occurrences[_index(-variable)];
+
+    uintptr_t occurrences = positive.size() + negative.size();
+    if (occurrences == 0 or occurrences > _limits.elimination_occurrences)
+        return true;
+
+    // Variable is eliminated only if its clauses can be replaced by not more resolvents
+    std::vector<std::vector<Literal>> resolvents;
+    std::vector<Literal> resolvent;
+    for (uint32_t positive_clause : positive)
+    {
+        for (uint32_t negative_clause : negative)
+        {
+            _elimination_steps += _clauses[positive_clause].literals.size() + _clauses[negative_clause].literals.size();
+            if (not _resolve(_clauses[positive_clause].literals, _clauses[negative_clause].literals, variable, resolvent))
+                continue;
+
+            if (resolvent.size() > _limits.resolvent_size or resolvents.size() == occurrences)
+                return true;
+
+            resolvents.push_back(resolvent);
+        }
+    }
+
+    dprintf("Eliminating variable %d: %lu clauses replaced by %lu resolvents\n", variable, occurrences, resolvents.size());
+
+    for (uint32_t clause : positive)
+    {
+        _pushReconstruction(_clauses[clause].literals, variable);
+        _removeClause(clause);
+    }
+    for (uint32_t clause : negative)
+    {
+        _pushReconstruction(_clauses[clause].literals, -variable);
+        _removeClause(clause);
+    }
+
+    _eliminated[variable] = true;
+    _stats.eliminated_variables++;
+    _stats.resolvents += resolvents.size();
+
+    for (std::vector<Literal>& literals : resolvents)
+        if (not _addClause(literals))
+            return false;
+
+    return true;
+}
+
+bool Preprocessor::_resolve(std::vector<Literal>& positive, std::vector<Literal>& negative, Literal variable, std::vector<Literal>& resolvent)
+{
+    resolvent.clear();
+
+    // Merging two sorted clauses without pivot variable
+    uintptr_t positive_idx = 0;
+    uintptr_t negative_idx = 0;
+    while (positive_idx < positive.size() or negative_idx < negative.size())
+    {
+        Literal literal = EmptyLiteral;
+        if (negative_idx == negative.size() or (positive_idx < positive.size() and _byVariable(positive[positive_idx], negative[negative_idx])))
+            literal = positive[positive_idx++];
+        else
+            literal = negative[negative_idx++];
+
+        if (abs(literal) == variable)
+            continue;
+
+        if (not resolvent.empty() and abs(resolvent.back()) == abs(literal))
+        {
+            if (resolvent.back() != literal)
+                return false;
+            continue;
+        }
+
+        resolvent.push_back(literal);
+    }
+
+    return true;
+}
+
+bool Preprocessor::_probe(CNF& cnf)
+{
+    CNF::ActionResult res = cnf.Check();
+    if (res == CNF::ActionResult::OK)
+        res = cnf.RemoveSingularClauses();
+
+    uint64_t probes = 0;
+    for (Literal variable = 1; variable <= (Literal) _variables_count and res == CNF::ActionResult::OK; variable++)
+    {
+        if (probes >= _limits.probes or _expired())
+        {
+            dprintf("Probing stopped on variable %d\n", variable);
+            break;
+        }
+
+        if (cnf.Value(variable) != 0 or _eliminated[variable] or _values[variable] != 0)
+            continue;
+
+        for (Literal literal : { variable, -variable })
+        {
+            probes++;
+            if (not cnf.IsUnsatPropagation(literal))
+                continue;
+
+            dprintf("Literal %d failed on probing\n", literal);
+            _stats.failed_literals++;
+
+            res = cnf.PropagateUnit(-literal);
+            if (res == CNF::ActionResult::OK)
+                res = cnf.RemoveSingularClauses();
+            break;
+        }
+    }
+
+    if (res == CNF::ActionResult::EMPTY_CLAUSE_CREATED)
+    {
+        cnf._reset();
+        return false;
+    }
+
+    // Literals fixed on probing are restored by reconstruction, remaining clauses replace cnf
+    std::vector<Literal> unit(1);
+    bool fixed = false;
+    for (Literal variable = 1; variable <= (Literal) _variables_count; variable++)
+    {
+        if (cnf.Value(variable) == 0)
+            continue;
+
+        unit[0] = cnf.Value(variable) > 0 ? variable : -variable;
+        _pushReconstruction(unit, unit[0]);
+        fixed = true;
+    }
+
+    // Search state of probing is dropped, so solver gets cnf as unprepared as it was given
+    if (fixed)
+    {
+        CNF remaining(cnf);
+        cnf = remaining;
+    }
+    else
+        cnf._reset();
+
+    return true;
+}
+
+void Preprocessor::Extend(std::vector<Literal>& model)
+{
+    for (Literal variable = model.size() + 1; variable <= (Literal) _variables_count; variable++)
+        model.push_back(variable);
+
+    // Going back in time, every removed clause is satisfied by flipping its pivot if needed
+    uintptr_t idx = _reconstruction.size();
+    while (idx > 0)
+    {
+        uint32_t size = _reconstruction[--idx];
+        idx -= size;
+
+        Literal* clause = _reconstruction.data() + idx;
+        bool satisfied = false;
+        for (uint32_t lit_no = 1; lit_no < size and not satisfied; lit_no++)
+            satisfied = model[abs(clause[lit_no]) - 1] == clause[lit_no];
+
+        if (not satisfied)
+            model[abs(clause[0]) - 1] = clause[0];
+    }
+}
@@ -0,0 +1,538 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "cnf.hxx"
+#include "literal.hxx"
+#include "dprintf.hxx"
+
+typedef uint32_t ClauseRef;
+
+const ClauseRef NoClause = UINT32_MAX;
+
+class Propagator
+{
+public:
+
+    struct Watch
+    {
+        ClauseRef clause;
+        Literal blocker; /// Some other literal of clause, if it is true clause can be skipped without touching it
+    };
+
+    Propagator(CNF& cnf);
+    Propagator(Propagator&) = delete;
+    ~Propagator();
+
+    int8_t Value(Literal literal); /// 1 if literal is true, -1 if false, 0 if unassigned
+    bool Assign(Literal literal, ClauseRef reason); /// Putting literal on trail, returning false if it is already false
+    CNF::ActionResult Propagate(); /// Propagating all literals from queue until fixpoint or conflict
+    void NewDecisionLevel(); /// Marking trail, all following assignments can be undone with Backtrack
+    void Backtrack(uint32_t level); /// Unassigning all literals assigned after decision level was opened
+    template <class Callback>
+    void Backtrack(uint32_t level, Callback unassigned); /// Same, calling unassigned(literal) for every undone literal
+    uint32_t DecisionLevel();
+
+    Literal NextUnassigned(); /// Returning first unassigned variable (positive literal)
+    uint32_t TrailSize();
+    uint32_t VariablesCount();
+    uint64_t Propagations(); /// Literals assigned since construction, decisions included
+    Literal* ConflictClause(uint32_t& size); /// Clause which became empty on last failed propagation
+
+    uint32_t Analyze(std::vector<Literal>& learned); /// Deriving 1-UIP clause from last conflict, returning level to backjump to
+    uint32_t Learn(std::vector<Literal>& learned); /// Storing clause from Analyze and asserting its first literal, must be called after backjump, returning its lbd
+    bool AddClause(const Literal* literals, uint32_t size); /// Adding clause derived elsewhere as learned one, must be called on level 0, returning false if it is falsified
+    void ReduceLearned(); /// Removing satisfied clauses and worse half of learned ones, must be called on level 0
+    std::vector<Literal>& Analyzed(); /// Variables met during last conflict analysis
+    uint32_t LearnedCount();
+
+private:
+
+    static uint32_t _index(Literal literal); /// Position of literal in watch lists
+    Literal* _clause(ClauseRef ref);
+    uint32_t _clauseSize(ClauseRef ref);
+    ClauseRef _store(Literal* literals, uint32_t size, uint32_t lbd);
+    void _attach(ClauseRef ref);
+    void _enqueue(Literal literal, ClauseRef reason);
+    bool _redundant(Literal literal); /// Checking if all literals of reason are already in learned clause
+
+    std::vector<Literal> _arena; /// Clause storage: [size, lbd, literals...] for every clause, lbd is 0 for original clauses
+    std::vector<ClauseRef> _learned;
+    std::vector<Literal> _analyzed;
+    std::vector<Watch>* _watches = nullptr; /// Clauses watching literal, indexed by _index(literal)
+
+    int8_t* _values = nullptr; /// Current value of every variable
+    Literal* _trail = nullptr; /// Assigned literals in order of assignment
+    uint32_t _trail_size = 0;
+    uint32_t _queue_head = 0; /// Literals on trail after this position are not propagated yet
+    uint32_t* _trail_limits = nullptr; /// Trail size at the moment every decision level was opened
+    uint32_t _decision_level = 0;
+    uint64_t _propagations = 0;
+
+    uint32_t* _levels = nullptr; /// Decision level on which variable was assigned
+    ClauseRef* _reasons = nullptr; /// Clause which implied variable, NoClause for decisions
+    bool* _seen = nullptr; /// Variables met during conflict analysis
+    uint32_t* _level_stamps = nullptr; /// Used to count distinct levels in learned clause
+    uint32_t _stamp = 0;
+
+    Literal _next_variable = 1; /// All variables before this one are assigned
+    uint32_t _variables_count = 0;
+    ClauseRef _conflict = NoClause;
+    bool _empty_clause = false; /// Initial CNF contained empty clause
+};
+
+Propagator::Propagator(CNF& cnf)
+{
+    _variables_count = cnf._variables_count;
+    for (uintptr_t idx = 0; idx < cnf._cnf_data_size; idx++)
+        if ((uint32_t) abs(cnf._cnf_data[idx]) > _variables_count)
+            _variables_count = abs(cnf._cnf_data[idx]);
+
+    _watches = new std::vector<Watch>[2 * (_variables_count + 1)];
+    _values = new int8_t[_variables_count + 1] { 0 };
+    _trail = new Literal[_variables_count + 1] { EmptyLiteral };
+    _trail_limits = new uint32_t[_variables_count + 2] { 0 };
+    _levels = new uint32_t[_variables_count + 1] { 0 };
+    _reasons = new ClauseRef[_variables_count + 1];
+    _seen = new bool[_variables_count + 1] { false };
+    _level_stamps = new uint32_t[_variables_count + 2] { 0 };
+    std::fill(_reasons, _reasons + _variables_count + 1, NoClause);
+    _arena.reserve(cnf._cnf_data_size + 2 * cnf._clauses_count);
+
+    uintptr_t clause_start = 0;
+    for (uintptr_t idx = 0; idx < cnf._cnf_data_size; idx++)
+    {
+        if (cnf._cnf_data[idx] != EmptyLiteral)
+            continue;
+
+        uint32_t size = idx - clause_start;
+        if (size == 0)
+            _empty_clause = true;
+        else if (size == 1)
+        {
+            if (not Assign(cnf._cnf_data[clause_start], NoClause))
+                _empty_clause = true;
+        }
+        else
+            _attach(_store(cnf._cnf_data + clause_start, size, 0));
+
+        clause_start = idx + 1;
+    }
+
+    dprintf("Propagator built for %d variables, %lu literals stored\n", _variables_count, _arena.size());
+}
+
+Propagator::~Propagator()
+{
+    delete[] _watches;
+    delete[] _values;
+    delete[] _trail;
+    delete[] _trail_limits;
+    delete[] _levels;
+    delete[] _reasons;
+    delete[] _seen;
+    delete[] _level_stamps;
+}
+
+int8_t Propagator::Value(Literal literal)
+{
+    int8_t value = _values[abs(literal)];
+    return literal < 0 ? -value : value;
+}
+
+bool Propagator::Assign(Literal literal, ClauseRef reason = NoClause)
+{
+    int8_t value = Value(literal);
+    if (value == 0)
+        _enqueue(literal, reason);
+    return value != -1;
+}
+
+CNF::ActionResult Propagator::Propagate()
+{
+    if (_empty_clause)
+        return CNF::ActionResult::EMPTY_CLAUSE_CREATED;
+
+    while (_queue_head < _trail_size)
+    {
+        Literal falsified = -_trail[_queue_head++];
+        std::vector<Watch>& watches = _watches[_index(falsified)];
+
+        uintptr_t kept = 0;
+        uintptr_t idx = 0;
+        for (; idx < watches.size(); idx++)
+        {
+            Watch watch = watches[idx];
+            if (Value(watch.blocker) == 1)
+            {
+                watches[kept++] = watch;
+                continue;
+            }
+
+            Literal* clause = _clause(watch.clause);
+            uint32_t size = _clauseSize(watch.clause);
+
+            // Falsified watch is always kept in the second position
+            if (clause[0] == falsified)
+            {
+                clause[0] = clause[1];
+                clause[1] = falsified;
+            }
+
+            Literal other = clause[0];
+            if (other != watch.blocker and Value(other) == 1)
+            {
+                watches[kept++] = { watch.clause, other };
+                continue;
+            }
+
+            bool moved = false;
+            for (uint32_t lit_no = 2; lit_no < size; lit_no++)
+            {
+                if (Value(clause[lit_no]) != -1)
+                {
+                    clause[1] = clause[lit_no];
+                    clause[lit_no] = falsified;
+                    _watches[_index(clause[1])].push_back({ watch.clause, other });
+                    moved = true;
+                    break;
+                }
+            }
+
+            if (moved)
+                continue;
+
+            watches[kept++] = { watch.clause, other };
+
+            if (Value(other) == -1)
+            {
+                dprintf("Conflict in clause %u while propagating %d\n", watch.clause, -falsified);
+                for (idx++; idx < watches.size(); idx++)
+                    watches[kept++] = watches[idx];
+                watches.resize(kept);
+
+                _conflict = watch.clause;
+                _queue_head = _trail_size;
+                return CNF::ActionResult::EMPTY_CLAUSE_CREATED;
+            }
+
+            _enqueue(other, watch.clause);
+        }
+
+        watches.resize(kept);
+    }
+
+    return CNF::ActionResult::OK;
+}
+
+void Propagator::NewDecisionLevel()
+{
+    _trail_limits[_decision_level++] = _trail_size;
+}
+
+void Propagator::Backtrack(uint32_t level)
+{
+    Backtrack(level, [](Literal) { });
+}
+
+template <class Callback>
+void Propagator::Backtrack(uint32_t level, Callback unassigned)
+{
+    if (level >= _decision_level)
+        return;
+
+    uint32_t trail_size = _trail_limits[level];
+    while (_trail_size > trail_size)
+    {
+        Literal literal = _trail[--_trail_size];
+        Literal variable = abs(literal);
+        _values[variable] = 0;
+        if (variable < _next_variable)
+            _next_variable = variable;
+        unassigned(literal);
+    }
+
+    if (_queue_head > _trail_size)
+        _queue_head = _trail_size;
+
+    _decision_level = level;
+}
+
+uint32_t Propagator::DecisionLevel()
+{
+    return _decision_level;
+}
+
+Literal Propagator::NextUnassigned()
+{
+    while (_next_variable <= (Literal) _variables_count and _values[_next_variable] != 0)
+        _next_variable++;
+
+    return _next_variable <= (Literal) _variables_count ? _next_variable : EmptyLiteral;
+}
+
+uint32_t Propagator::TrailSize()
+{
+    return _trail_size;
+}
+
+uint64_t Propagator::Propagations()
+{
+    return _propagations;
+}
+
+uint32_t Propagator::VariablesCount()
+{
+    return _variables_count;
+}
+
+Literal* Propagator::ConflictClause(uint32_t& size)
+{
+    size = _conflict == NoClause ? 0 : _clauseSize(_conflict);
+    return _conflict == NoClause ? nullptr : _clause(_conflict);
+}
+
+uint32_t Propagator::Analyze(std::vector<Literal>& learned)
+{
+    learned.clear();
+    learned.push_back(EmptyLiteral); // Place for asserting literal
+    _analyzed.clear();
+
+    int current_level_count = 0; // Literals of current level not resolved yet
+    Literal resolved = EmptyLiteral;
+    ClauseRef reason = _conflict;
+    uint32_t trail_idx = _trail_size;
+
+    do
+    {
+        Literal* clause = _clause(reason);
+        uint32_t size = _clauseSize(reason);
+
+        // First literal of reason clause is the one it implied
+        for (uint32_t lit_no = resolved == EmptyLiteral ? 0 : 1; lit_no < size; lit_no++)
+        {
+            Literal variable = abs(clause[lit_no]);
+            if (_seen[variable] or _levels[variable] == 0)
+                continue;
+
+            _seen[variable] = true;
+            _analyzed.push_back(variable);
+            if (_levels[variable] == _decision_level)
+                current_level_count++;
+            else
+                learned.push_back(clause[lit_no]);
+        }
+
+        while (not _seen[abs(_trail[--trail_idx])]);
+
+        resolved = _trail[trail_idx];
+        reason = _reasons[abs(resolved)];
+        _seen[abs(resolved)] = false;
+        current_level_count--;
+    }
+    while (current_level_count > 0);
+
+    learned[0] = -resolved;
+
+    // Literals implied by other literals of learned clause are dropped
+    uintptr_t kept = 1;
+    for (uintptr_t idx = 1; idx < learned.size(); idx++)
+        if (not _redundant(learned[idx]))
+            learned[kept++] = learned[idx];
+    learned.resize(kept);
+
+    for (Literal variable : _analyzed)
+        _seen[variable] = false;
+
+    // Literal of highest level is watched together with asserting one
+    uint32_t backjump_level = 0;
+    for (uintptr_t idx = 1; idx < learned.size(); idx++)
+    {
+        if (_levels[abs(learned[idx])] > backjump_level)
+        {
+            backjump_level = _levels[abs(learned[idx])];
+            std::swap(learned[1], learned[idx]);
+        }
+    }
+
+    dprintf("Learned clause of %lu literals, backjumping from %d to %d\n", learned.size(), _decision_level, backjump_level);
+
+    return backjump_level;
+}
+
+uint32_t Propagator::Learn(std::vector<Literal>& learned)
+{
+    if (learned.size() == 1)
+    {
+        Assign(learned[0]);
+        return 1;
+    }
+
+    // Asserting literal is still unassigned, it will get its own level
+    _stamp++;
+    uint32_t lbd = 1;
+    for (uintptr_t idx = 1; idx < learned.size(); idx++)
+    {
+        uint32_t level = _levels[abs(learned[idx])];
+        if (_level_stamps[level] != _stamp)
+        {
+            _level_stamps[level] = _stamp;
+            lbd++;
+        }
+    }
+
+    ClauseRef ref = _store(learned.data(), learned.size(), lbd);
+    _attach(ref);
+    _learned.push_back(ref);
+    Assign(learned[0], ref);
+
+    return lbd;
+}
+
+bool Propagator::AddClause(const Literal* literals, uint32_t size)
+{
+    if (_decision_level != 0)
+        return true;
+
+    // On level 0 assigned literals are fixed forever, so they are just dropped from clause
+    std::vector<Literal> clause;
+    for (uint32_t lit_no = 0; lit_no < size; lit_no++)
+    {
+        int8_t value = Value(literals[lit_no]);
+        if (value == 1)
+            return true;
+        if (value == 0)
+            clause.push_back(literals[lit_no]);
+    }
+
+    if (clause.empty())
+    {
+        _empty_clause = true;
+        return false;
+    }
+
+    if (clause.size() == 1)
+        return Assign(clause[0]);
+
+    ClauseRef ref = _store(clause.data(), clause.size(), clause.size());
+    _attach(ref);
+    _learned.push_back(ref);
+
+    return true;
+}
+
+void Propagator::ReduceLearned()
+{
+    if (_decision_level != 0)
+        return;
+
+    const Literal removed = -1;
+
+    // Glue clauses (lbd <= 2) are always kept, others compete by lbd
+    std::stable_sort(_learned.begin(), _learned.end(), [this](ClauseRef a, ClauseRef b) { return _arena[a + 1] < _arena[b + 1]; });
+    for (uintptr_t idx = _learned.size() / 2; idx < _learned.size(); idx++)
+        if (_arena[_learned[idx] + 1] > 2)
+            _arena[_learned[idx] + 1] = removed;
+
+    std::vector<Literal> arena;
+    arena.reserve(_arena.size());
+    _learned.clear();
+
+    for (ClauseRef ref = 0; ref < _arena.size(); ref += 2 + _clauseSize(ref))
+    {
+        if (_arena[ref + 1] == removed)
+            continue;
+
+        Literal* clause = _clause(ref);
+        uint32_t size = _clauseSize(ref);
+
+        bool satisfied = false;
+        for (uint32_t lit_no = 0; lit_no < size and not satisfied; lit_no++)
+            satisfied = Value(clause[lit_no]) == 1;
+
+        if (satisfied)
+            continue;
+
+        if (_arena[ref + 1] != 0)
+            _learned.push_back(arena.size());
+        arena.insert(arena.end(), _arena.begin() + ref, _arena.begin() + ref + 2 + size);
+    }
+
+    dprintf("Clause storage reduced from %lu to %lu literals\n", _arena.size(), arena.size());
+
+    _arena.swap(arena);
+
+    // Watched literals keep their positions, so watches can be rebuilt from scratch
+    for (uint32_t idx = 0; idx < 2 * (_variables_count + 1); idx++)
+        _watches[idx].clear();
+    for (ClauseRef ref = 0; ref < _arena.size(); ref += 2 + _clauseSize(ref))
+        _attach(ref);
+
+    for (uint32_t idx = 0; idx < _trail_size; idx++)
+        _reasons[abs(_trail[idx])] = NoClause;
+}
+
+std::vector<Literal>& Propagator::Analyzed()
+{
+    return _analyzed;
+}
+
+uint32_t Propagator::LearnedCount()
+{
+    return _learned.size();
+}
+
+uint32_t Propagator::_index(Literal literal)
+{
+    return literal < 0 ? 2 * (-literal) + 1 : 2 * literal;
+}
+
+Literal* Propagator::_clause(ClauseRef ref)
+{
+    return _arena.data() + ref + 2;
+}
+
+uint32_t Propagator::_clauseSize(ClauseRef ref)
+{
+    return _arena[ref];
+}
+
+ClauseRef Propagator::_store(Literal* literals, uint32_t size, uint32_t lbd)
+{
+    ClauseRef ref = _arena.size();
+    _arena.push_back(size);
+    _arena.push_back(lbd);
+    _arena.insert(_arena.end(), literals, literals + size);
+    return ref;
+}
+
+void Propagator::_attach(ClauseRef ref)
+{
+    Literal* clause = _clause(ref);
+    _watches[_index(clause[0])].push_back({ ref, clause[1] });
+    _watches[_index(clause[1])].push_back({ ref, clause[0] });
+}
+
+void Propagator::_enqueue(Literal literal, ClauseRef reason)
+{
+    _values[abs(literal)] = literal < 0 ? -1 : 1;
+    _levels[abs(literal)] = _decision_level;
+    _reasons[abs(literal)] = reason;
+    _trail[_trail_size++] = literal;
+    _propagations++;
+}
+
+bool Propagator::_redundant(Literal literal)
+{
+    ClauseRef reason = _reasons[abs(literal)];
+    if (reason == NoClause)
+        return false;
+
+    Literal* clause = _clause(reason);
+    uint32_t size = _clauseSize(reason);
+    for (uint32_t lit_no = 1; lit_no < size; lit_no++)
+        if (not _seen[abs(clause[lit_no])] and _levels[abs(clause[lit_no])] > 0)
+            return false;
+
+    return true;
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include <cstdint>
 
 enum class Rule : uint8_t
@@ -6,7 +7,11 @@ enum class Rule : uint8_t
     RECURSIVE_SOLVING = 1 << 0,
     REMOVE_TRIVIAL = 1 << 1,
     REMOVE_SINGULAR = 1 << 2,
-    REMOVE_PURE = 1 << 3
+    REMOVE_PURE = 1 << 3,
+    WATCHED_LITERALS = 1 << 4,
+    CONFLICT_LEARNING = 1 << 5,
+    PHASE_SAVING = 1 << 6,
+    PREPROCESSING = 1 << 7
 };
 
 inline constexpr Rule operator|(Rule x, Rule y)
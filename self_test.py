@@ -1,8 +1,11 @@
-from sys import argv, stdout
-from os import listdir, fdopen
+from sys import argv, stdout, stderr
+from os import listdir, fdopen, cpu_count
+from tempfile import TemporaryFile
 from time import time
-from subprocess import run
-from json import dumps
+from subprocess import run, Popen, PIPE
+from json import dumps, loads
+import gzip
+import lzma
 import re
 
 def mcs():
@@ -16,42 +19,98 @@ run(['make', 'dpll', '-B'], capture_output=True)
 
 folder = argv[1].strip('/')
 
-results = {}
-
-duration = 0
-
 tests = listdir(folder)
 tests_count = len(tests)
-for num, test in enumerate(tests):
-
-    time_passed = duration / 1000000
-    time_left = 0 if num == 0 else (duration / (num) * (tests_count - num) / 1000000)
 
-    split_no = int(num / tests_count * 80)
-    counter = f' {num}/{tests_count} ({test.split('/')[-1]})'
-    timers = f'{time_passed:.2f} s, ETA: {time_left:.2f} s '
-    string = counter + ' ' * (80 - len(counter) - len(timers)) + timers
-    string = '\x1b[42m' + string[:split_no] + '\x1b[30;47m' + string[split_no:] + '\x1b[0m'
+# Every test is solved in all of these modes, answers of different modes have to agree
+modes = [[], ['--preprocess'], ['-j', '2'], ['--cubes', '3', '-j', '2']]
 
-    print(string, end='')
-    print('\b' * len(string), end='')
+def solve(mode):
+    results = {}
 
+    # All tests are solved by one batch process, it prints stats line of every test to stderr when it is finished.
+    # Answers go to file, so the pipe of answers can't fill up while stats are read
     start = mcs()
-    res = run(['./dpll', f'{folder}/{test}'], capture_output=True)
-    executed_in = mcs() - start
-    duration += executed_in
-
-    success = res.returncode == 0
-    if success:
-        output = res.stdout #.decode().strip('\n').split('\n')
-    else:
-        output = b''
-    results[f'{folder}/{test}'] = {'success': success, 'output': output, 'executed_in': f'{executed_in / 1000:.2f} ms'}
-    
-print(' ' * 80, end='')
-print('\b' * 80, end='')
-
-print(f'Finished {len(tests)} tests in {duration / 1000000:.0f} s')
+    answers_file = TemporaryFile('w+')
+    solver = Popen(['./dpll', '--batch', '-', '--jobs', str(cpu_count() or 1)] + mode, stdin=PIPE, stdout=answers_file, stderr=PIPE, text=True)
+    solver.stdin.write(''.join(f'{folder}/{test}\n' for test in tests))
+    solver.stdin.close()
+
+    num = 0
+    for line in solver.stderr:
+        if not line.startswith('{'):
+            stderr.write(line)
+            continue
+
+        stats = loads(line)
+        results[stats['file']] = {'success': stats['status'] not in ('ERROR', 'MEMOUT'), 'output': [],
+                                  'executed_in': '%.2f ms' % (stats['wall_seconds'] * 1000), 'stats': stats}
+        num += 1
+        duration = mcs() - start
+
+        time_passed = duration / 1000000
+        time_left = duration / num * (tests_count - num) / 1000000
+
+        split_no = int(num / tests_count * 80)
+        test = stats['file'].split('/')[-1]
+        counter = f' {num}/{tests_count} ({test})'
+        timers = f'{time_passed:.2f} s, ETA: {time_left:.2f} s '
+        string = counter + ' ' * (80 - len(counter) - len(timers)) + timers
+        string = '\x1b[42m' + string[:split_no] + '\x1b[30;47m' + string[split_no:] + '\x1b[0m'
+
+        print(string, end='')
+        print('\b' * len(string), end='')
+        stdout.flush()
+
+    solver.wait()
+
+    print(' ' * 80, end='')
+    print('\b' * 80, end='')
+
+    # Answer of every test starts with 'c <file>' line, its status from stats ends the output
+    answers_file.seek(0)
+    test = None
+    for line in answers_file:
+        if line.startswith('c '):
+            test = line[2:].rstrip('\n')
+        elif test in results:
+            results[test]['output'].append(line.rstrip('\n'))
+
+    for test in results:
+        results[test]['output'].append(results[test]['stats']['status'])
+
+    return results
+
+def satisfied(test, output):
+    """Checking that 'v' lines of output satisfy every clause of test"""
+    model = set(int(literal) for line in output if line.startswith('v ') for literal in line[2:].split())
+
+    opener = gzip.open if test.endswith('.gz') else lzma.open if test.endswith('.xz') else open
+    clause = []
+    with opener(test, 'rt') as cnf:
+        for line in cnf:
+            if line.startswith('%'):
+                break
+            if line.startswith(('c', 'p')):
+                continue
+            for literal in map(int, line.split()):
+                if literal != 0:
+                    clause.append(literal)
+                elif not any(literal in model for literal in clause):
+                    return False
+                else:
+                    clause = []
+    return True
+
+start = mcs()
+results = {}
+for mode in modes:
+    name = ' '.join(mode) or 'default'
+    print(f'Solving in {name} mode')
+    results[name] = solve(mode)
+duration = mcs() - start
+
+print(f'Finished {len(tests)} tests in {len(modes)} modes in {duration / 1000000:.0f} s')
 
 exited_normally = 0
 exited_abnormally = 0
@@ -60,42 +119,49 @@ failed = 0
 SAT_tests = []
 UNSAT_tests = []
 unclear_tests = []
-
-for test in results:
-
-    results[test]['output'] = results[test]['output'].decode().strip('\n').split('\n')
-    newlines = []
-    for line in results[test]['output']:
-        line = line.replace('\x1b[0m', '').replace('\x1b[35m', '')
-        if line.startswith('>> debug from'):
-            line = re.findall(r'>> debug from <[\w\d_\-.]+::\d+>: ([^\n]+)', line)[0]
-        newlines.append(line)
-    results[test]['output'] = newlines
-
-    if results[test]['success']: 
-        exited_normally += 1
-
-        if results[test]['output'][-1].endswith('UNSAT'):
-            UNSAT_tests.append(test)
-            if test.split('/')[-1].lower().startswith('unsat') or test.split('/')[-1].lower().startswith('uuf'): passed += 1
-            else: failed += 1
-
-        elif results[test]['output'][-1].endswith('SAT'):
-            SAT_tests.append(test)
-            if test.split('/')[-1].lower().startswith('sat') or test.split('/')[-1].lower().startswith('uf'): passed += 1
-            else: failed += 1
-
-        else:
-            unclear_tests.append(test)
-            failed += 1
-
-    else: exited_abnormally += 1
+wrong_models = []
+
+for name in results:
+    for test in results[name]:
+        result = results[name][test]
+
+        newlines = []
+        for line in result['output']:
+            line = line.replace('\x1b[0m', '').replace('\x1b[35m', '')
+            if line.startswith('>> debug from'):
+                line = re.findall(r'>> debug from <[\w\d_\-.]+::\d+>: ([^\n]+)', line)[0]
+            newlines.append(line)
+        result['output'] = newlines
+
+        if result['success']:
+            exited_normally += 1
+
+            if result['output'][-1].endswith('UNSAT'):
+                UNSAT_tests.append(f'{test} ({name})')
+                if test.split('/')[-1].lower().startswith('unsat') or test.split('/')[-1].lower().startswith('uuf'): passed += 1
+                else: failed += 1
+
+            elif result['output'][-1].endswith('SAT'):
+                SAT_tests.append(f'{test} ({name})')
+                if not satisfied(test, result['output']):
+                    wrong_models.append(f'{test} ({name})')
+                    print(f'Wrong model of {test} in {name} mode')
+                    failed += 1
+                elif test.split('/')[-1].lower().startswith('sat') or test.split('/')[-1].lower().startswith('uf'): passed += 1
+                else: failed += 1
+
+            else:
+                unclear_tests.append(f'{test} ({name})')
+                failed += 1
+
+        else: exited_abnormally += 1
 
 print(f'Exited normally: {exited_normally}/{exited_normally + exited_abnormally}')
 print(f'Passed: {passed}/{passed + failed}')
 print(f'SAT in {len(SAT_tests)} tests')
 print(f'UNSAT in {len(UNSAT_tests)} tests')
 print(f'Unclear output in {len(unclear_tests)} tests')
+print(f'Wrong model in {len(wrong_models)} tests')
 
 with open(f'{folder}_results.json', 'w') as res_file:
     res_file.write(
@@ -108,5 +174,6 @@ with open(f'{folder}_results.json', 'w') as res_file:
             'SAT': f'{len(SAT_tests)}/{exited_normally}',
             'UNSAT': f'{len(UNSAT_tests)}/{exited_normally}',
             'confusing_output': f'{len(unclear_tests)}/{exited_normally}',
+            'wrong_models': f'{len(wrong_models)}/{len(SAT_tests)}',
             'results': results
         }, ensure_ascii=False, indent=2))
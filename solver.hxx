@@ -1,7 +1,14 @@
+#pragma once
 #include "dprintf.hxx"
 #include "cnf.hxx"
+#include "propagator.hxx"
+#include "heuristic.hxx"
+#include "clause_exchange.hxx"
+#include "cube_pool.hxx"
+#include "preprocessor.hxx"
 #include "rules.hxx"
 #include <cmath>
+#include <atomic>
 
 class Solver
 {
@@ -12,42 +19,179 @@ public:
         UNKNOWN, SAT, UNSAT
     };
 
-    Solver(Rule rules);
+    /// Counters of last Solve or SolveCubes call
+    struct Statistics
+    {
+        uint64_t decisions = 0;
+        uint64_t propagations = 0; /// Assigned literals, decisions included
+        uint64_t conflicts = 0;
+    };
+
+    Solver(Rule rules, Heuristic heuristic, uint32_t seed);
+    Solver(Solver&) = delete;
 
     Status Solve(CNF cnf);
+    Status SolveCubes(CNF cnf, CubePool& pool, uint32_t worker); /// Solving cubes from pool until one is SAT or pool is empty, DPLL gives away branches to idle workers
+
+    void StopOn(const std::atomic<bool>* stop); /// Making search return UNKNOWN as soon as flag is raised
+    void ShareClauses(ClauseExchange* exchange, uint32_t id); /// Exporting short learned clauses to exchange and importing others on restarts
 
-    uint64_t Complexity();
+    uint64_t Complexity(); /// Steps made by last Solve or SolveCubes call
+    const Statistics& Stats();
+    std::string Branching(); /// Name of branching heuristic used by solver
+    std::vector<Literal>& Model(); /// Literal of every variable (model[var - 1]) satisfying CNF from last SAT answer
+    const Preprocessor::Statistics& PreprocessingStats();
 
 private:
 
     Literal _getLiteral(CNF& cnf);
+    Literal _getLiteral(Propagator& propagator);
+    template <class Engine>
+    void _bumpConflict(Engine& engine); /// Bumping activity of variables from clause which became empty
+    template <class Engine>
+    void _saveModel(Engine& engine); /// Remembering current assignment, unassigned variables are set to true
 
-    Status _DPLLRecursive(CNF cnf, Literal propagate);
+    Status _DPLLRecursive(CNF& cnf, Literal propagate);
     Status _DPLLLinear_test(CNF cnf);
-    Status _DPLLLinear(CNF cnf);
+    Status _DPLLLinear(CNF& cnf);
+    Status _DPLLWatched(CNF& cnf);
+    Status _DPLLWatched(Propagator& propagator, std::vector<Literal>& cube); /// Searching under cube assumed on decision level 1
+    Status _CDCL(CNF& cnf);
+    Status _CDCL(Propagator& propagator, std::vector<Literal>& cube); /// Searching with cube literals as first decisions, so learned clauses hold without cube
+    static uint64_t _luby(uint64_t idx); /// idx-th element of Luby sequence (1 1 2 1 1 2 4 ...)
+    bool _stopped();
+    void _export(std::vector<Literal>& learned, uint32_t lbd);
+    bool _import(Propagator& propagator); /// Adding clauses shared by other solvers, returning false if CNF became UNSAT
     Rule _rules = Rule::NONE;
     bool _recursiveSolving();
+    bool _watchedLiterals();
+    bool _conflictLearning();
+    bool _phaseSaving();
+    bool _preprocessing();
     bool _removeTrivial();
     bool _removeSingular();
     bool _removePure();
 
+    Heuristic _heuristic = Heuristic::FIRST_LITERAL;
+    Brancher _brancher;
+    Preprocessor _preprocessor;
+    std::vector<Literal> _model;
+
     uint64_t _complexity = 0;
+    Statistics _stats;
+
+    const std::atomic<bool>* _stop = nullptr;
+    ClauseExchange* _exchange = nullptr;
+    uint32_t _exchange_id = 0;
+    uint64_t _exchange_cursor = 0;
+
+    CubePool* _pool = nullptr;
+    uint32_t _worker = 0;
+    bool _refuted = false; /// CDCL found level 0 conflict, so CNF is UNSAT whatever cube is assumed
 };
 
-Solver::Solver(Rule rules = Rule::NONE) : _rules(rules) { }
+Solver::Solver(Rule rules = Rule::NONE, Heuristic heuristic = Heuristic::FIRST_LITERAL, uint32_t seed = 0) :
+    _rules(rules), _heuristic(heuristic), _brancher(heuristic, _phaseSaving(), seed) { }
+
+void Solver::StopOn(const std::atomic<bool>* stop)
+{
+    _stop = stop;
+    _preprocessor.StopOn(stop);
+}
+
+void Solver::ShareClauses(ClauseExchange* exchange, uint32_t id)
+{
+    _exchange = exchange;
+    _exchange_id = id;
+    _exchange_cursor = 0;
+}
+
+bool Solver::_stopped()
+{
+    return _stop and _stop->load(std::memory_order_relaxed);
+}
+
+void Solver::_export(std::vector<Literal>& learned, uint32_t lbd)
+{
+    // Only units, binaries and glue clauses are worth the traffic
+    if (_exchange and (learned.size() <= 2 or lbd <= 2))
+        _exchange->Export(_exchange_id, learned.data(), learned.size());
+}
+
+bool Solver::_import(Propagator& propagator)
+{
+    if (not _exchange)
+        return true;
+
+    bool consistent = true;
+    _exchange->Import(_exchange_id, _exchange_cursor, [&](const Literal* literals, uint32_t size)
+    {
+        if (consistent)
+            consistent = propagator.AddClause(literals, size);
+    });
+
+    return consistent;
+}
 
 Literal Solver::_getLiteral(CNF& cnf)
 {
-    Literal t = cnf.FirstLiteral();
-    if (t < 0) t = -t;
-    return t;
+    Literal decision = EmptyLiteral;
+    if (_heuristic != Heuristic::FIRST_LITERAL)
+        decision = _brancher.Pick(cnf);
+    else
+    {
+        Literal t = cnf.FirstLiteral();
+        if (t < 0) t = -t;
+        decision = _brancher.Polarity(t);
+    }
+
+    if (decision != EmptyLiteral)
+        _stats.decisions++;
+    return decision;
+}
+
+Literal Solver::_getLiteral(Propagator& propagator)
+{
+    Literal decision = _heuristic != Heuristic::FIRST_LITERAL ? _brancher.Pick(propagator) : _brancher.Polarity(propagator.NextUnassigned());
+
+    if (decision != EmptyLiteral)
+        _stats.decisions++;
+    return decision;
+}
+
+template <class Engine>
+void Solver::_saveModel(Engine& engine)
+{
+    _model.clear();
+    for (Literal variable = 1; variable <= (Literal) engine.VariablesCount(); variable++)
+        _model.push_back(engine.Value(variable) < 0 ? -variable : variable);
+}
+
+template <class Engine>
+void Solver::_bumpConflict(Engine& engine)
+{
+    _stats.conflicts++;
+
+    uint32_t size = 0;
+    Literal* clause = engine.ConflictClause(size);
+    for (uint32_t lit_no = 0; lit_no < size; lit_no++)
+        _brancher.Bump(clause[lit_no]);
+    _brancher.Decay();
 }
 
-Solver::Status Solver::_DPLLRecursive(CNF cnf, Literal propagate = EmptyLiteral)
+Solver::Status Solver::_DPLLRecursive(CNF& cnf, Literal propagate = EmptyLiteral)
 {
+    if (_stopped())
+        return Status::UNKNOWN;
+
     _complexity++;
     dprintf("Solving CNF of %d clauses, propagating = %d\n", cnf.ClausesCount(), propagate);
 
+    uint32_t level = cnf.DecisionLevel();
+    cnf.NewDecisionLevel();
+
+    auto unassigned = [this](Literal literal) { _brancher.Unassigned(literal); };
+
     CNF::ActionResult res = CNF::ActionResult::OK;
     if ((propagate != EmptyLiteral and (res = cnf.PropagateUnit(propagate)) != CNF::ActionResult::OK) or 
         (_removeSingular() and (res = cnf.RemoveSingularClauses()) != CNF::ActionResult::OK) or
@@ -57,38 +201,49 @@ Solver::Status Solver::_DPLLRecursive(CNF cnf, Literal propagate = EmptyLiteral)
 exit:
     switch (res)
     {
-        case CNF::ActionResult::CNF_DEVASTED: return Status::SAT; // If cnf was devasted, this branch is SAT
-        case CNF::ActionResult::EMPTY_CLAUSE_CREATED: return Status::UNSAT; // If empty clause was created, this branch is UNSAT
+        case CNF::ActionResult::CNF_DEVASTED: _saveModel(cnf); return Status::SAT; // If cnf was devasted, this branch is SAT
+        case CNF::ActionResult::EMPTY_CLAUSE_CREATED: _bumpConflict(cnf); cnf.Backtrack(level, unassigned); return Status::UNSAT; // If empty clause was created, this branch is UNSAT
     }
 
     Literal to_propagate = _getLiteral(cnf);
-    if (to_propagate < 0) to_propagate = -to_propagate;
 
-    if ((not cnf.IsUnsatPropagation(to_propagate) and _DPLLRecursive(cnf, to_propagate) == Status::SAT) or 
-        (not cnf.IsUnsatPropagation(-to_propagate) and _DPLLRecursive(cnf, -to_propagate) == Status::SAT)) 
-        return Status::SAT; // If one of sub-branches is SAT, current branch is SAT too
-    
+    for (Literal branch : { to_propagate, -to_propagate })
+    {
+        Status branch_result = cnf.IsUnsatPropagation(branch) ? Status::UNSAT : _DPLLRecursive(cnf, branch);
+        if (branch_result != Status::UNSAT)
+            return branch_result; // If one of sub-branches is SAT, current branch is SAT too
+    }
+
+    // When probing refuted both branches, picked variable was never assigned, so it is returned to brancher here
+    unassigned(to_propagate);
+    cnf.Backtrack(level, unassigned);
     return Status::UNSAT; // If all sub-branches are UNSAT, current branch is UNSAT too
 }
 
-Solver::Status Solver::_DPLLLinear(CNF initial_cnf)
+Solver::Status Solver::_DPLLLinear(CNF& cnf)
 {
     Status result = Status::UNSAT;
 
+    // Decision level of cnf is always equal to propagating_idx,
+    // so returning to previous branch is just undoing its trail
     int propagating_idx = 0;
-    int propagating_size = initial_cnf.VariablesCount() + 1;
+    int propagating_size = cnf.VariablesCount() + 1;
     Literal* propagating = new Literal[propagating_size] { 0 };
     bool* prop_checked_both = new bool[propagating_size] { false };
-    CNF* cnfs = new CNF[propagating_size];
-    cnfs[0] = initial_cnf;
 
-    #define cnf cnfs[propagating_idx]
-    #define prev_cnf cnfs[propagating_idx - 1]
+    auto unassigned = [this](Literal literal) { _brancher.Unassigned(literal); };
+
     #define propagate propagating[propagating_idx]
     #define checked_both prop_checked_both[propagating_idx]
 
     while (true)
     {
+        if (_stopped())
+        {
+            result = Status::UNKNOWN;
+            break;
+        }
+
         _complexity++;
         dprintf("Solving CNF of %d clauses, propagating = %d\n%s\n", cnf.ClausesCount(), propagating[propagating_idx], cnf.ToString().c_str());
 
@@ -101,12 +256,15 @@ Solver::Status Solver::_DPLLLinear(CNF initial_cnf)
     exit:
         if (res == CNF::ActionResult::CNF_DEVASTED)
         {
+            _saveModel(cnf);
             result = Status::SAT;
             break;
         }
 
         else if (res == CNF::ActionResult::EMPTY_CLAUSE_CREATED)
         {
+            _bumpConflict(cnf);
+
             while (propagating_idx > 0 and checked_both)
             {
                 propagate = EmptyLiteral;
@@ -122,7 +280,8 @@ Solver::Status Solver::_DPLLLinear(CNF initial_cnf)
 
             propagate = -propagate;
             checked_both = true;
-            cnf = prev_cnf;
+            cnf.Backtrack(propagating_idx - 1, unassigned);
+            cnf.NewDecisionLevel();
 
             dprintf("Empty clause created, trying another branch (idx = %d, literal = %d)\n", propagating_idx, propagating[propagating_idx]);
 
@@ -130,7 +289,7 @@ Solver::Status Solver::_DPLLLinear(CNF initial_cnf)
         }
 
         propagating_idx++;
-        cnf = prev_cnf;
+        cnf.NewDecisionLevel();
         checked_both = false;
 
         if (propagate == EmptyLiteral)
@@ -141,32 +300,335 @@ Solver::Status Solver::_DPLLLinear(CNF initial_cnf)
 
     delete[] propagating;
     delete[] prop_checked_both;
-    delete[] cnfs;
 
-    #undef cnf
-    #undef prev_cnf
     #undef propagate
     #undef checked_both
 
     return result;
 }
 
+Solver::Status Solver::_DPLLWatched(CNF& initial_cnf)
+{
+    Propagator propagator(initial_cnf);
+    std::vector<Literal> cube;
+
+    Status result = _DPLLWatched(propagator, cube);
+    _stats.propagations += propagator.Propagations();
+    return result;
+}
+
+Solver::Status Solver::_DPLLWatched(Propagator& propagator, std::vector<Literal>& cube)
+{
+    auto unassigned = [this](Literal literal) { _brancher.Unassigned(literal); };
+
+    propagator.Backtrack(0, unassigned);
+    if (propagator.Propagate() != CNF::ActionResult::OK)
+        return Status::UNSAT;
+
+    // Cube has its own level, so search never backtracks over it
+    propagator.NewDecisionLevel();
+    bool consistent = true;
+    for (uintptr_t idx = 0; idx < cube.size() and consistent; idx++)
+        consistent = propagator.Assign(cube[idx]);
+
+    if (not consistent or propagator.Propagate() != CNF::ActionResult::OK)
+    {
+        propagator.Backtrack(0, unassigned);
+        return Status::UNSAT;
+    }
+
+    // Decision level of propagator is always equal to base + decisions_idx
+    const uint32_t base = propagator.DecisionLevel();
+    int decisions_idx = 0;
+    int decisions_size = propagator.VariablesCount() + 1;
+    Literal* decisions = new Literal[decisions_size] { 0 };
+    bool* dec_checked_both = new bool[decisions_size] { false };
+
+    Status result = Status::UNSAT;
+
+    while (true)
+    {
+        if (_stopped())
+        {
+            result = Status::UNKNOWN;
+            break;
+        }
+
+        // Shallowest branch not tried yet is given away, here it is counted as already checked
+        if (_pool and _pool->Hungry())
+        {
+            for (int idx = 0; idx < decisions_idx; idx++)
+            {
+                if (dec_checked_both[idx])
+                    continue;
+
+                std::vector<Literal> sibling(cube);
+                sibling.insert(sibling.end(), decisions, decisions + idx);
+                sibling.push_back(-decisions[idx]);
+                dec_checked_both[idx] = true;
+                _pool->Push(_worker, sibling);
+
+                dprintf("Worker %u gave away branch %d on depth %d\n", _worker, -decisions[idx], idx);
+                break;
+            }
+        }
+
+        _complexity++;
+
+        Literal decision = _getLiteral(propagator);
+        if (decision == EmptyLiteral)
+        {
+            _saveModel(propagator);
+            result = Status::SAT;
+            break;
+        }
+
+        dprintf("Deciding %d on depth %d\n", decision, decisions_idx);
+
+        decisions[decisions_idx] = decision;
+        dec_checked_both[decisions_idx] = false;
+        decisions_idx++;
+        propagator.NewDecisionLevel();
+        propagator.Assign(decision);
+
+        // Flipping last unflipped decision until propagation stops failing
+        while (propagator.Propagate() == CNF::ActionResult::EMPTY_CLAUSE_CREATED)
+        {
+            _bumpConflict(propagator);
+
+            while (decisions_idx > 0 and dec_checked_both[decisions_idx - 1])
+                decisions_idx--;
+
+            if (decisions_idx == 0)
+                break;
+
+            propagator.Backtrack(base + decisions_idx - 1, unassigned);
+            propagator.NewDecisionLevel();
+            decisions[decisions_idx - 1] = -decisions[decisions_idx - 1];
+            dec_checked_both[decisions_idx - 1] = true;
+            propagator.Assign(decisions[decisions_idx - 1]);
+            _complexity++;
+
+            dprintf("Conflict, trying another branch (idx = %d, literal = %d)\n", decisions_idx - 1, decisions[decisions_idx - 1]);
+        }
+
+        if (decisions_idx == 0)
+            break;
+    }
+
+    delete[] decisions;
+    delete[] dec_checked_both;
+
+    if (result == Status::UNSAT)
+        propagator.Backtrack(0, unassigned);
+
+    return result;
+}
+
+Solver::Status Solver::_CDCL(CNF& initial_cnf)
+{
+    Propagator propagator(initial_cnf);
+    std::vector<Literal> cube;
+
+    Status result = _CDCL(propagator, cube);
+    _stats.propagations += propagator.Propagations();
+    return result;
+}
+
+Solver::Status Solver::_CDCL(Propagator& propagator, std::vector<Literal>& cube)
+{
+    const uint64_t restart_unit = 100; // Conflicts between restarts are luby(i) * restart_unit
+    const uint64_t reduce_interval = 2000; // Learned clauses are reduced after this many conflicts, interval slowly grows
+
+    std::vector<Literal> learned;
+
+    uint64_t conflicts = 0;
+    uint64_t restarts = 0;
+    uint64_t next_restart = _luby(restarts) * restart_unit;
+    uint64_t next_reduce = reduce_interval;
+    uint64_t reductions = 0;
+
+    auto unassigned = [this](Literal literal) { _brancher.Unassigned(literal); };
+
+    // Propagator may keep learned clauses from previous cube, but not its assignments
+    propagator.Backtrack(0, unassigned);
+
+    while (true)
+    {
+        if (_stopped())
+            return Status::UNKNOWN;
+
+        if (propagator.Propagate() == CNF::ActionResult::EMPTY_CLAUSE_CREATED)
+        {
+            conflicts++;
+            _stats.conflicts++;
+            if (propagator.DecisionLevel() == 0)
+            {
+                _refuted = true;
+                return Status::UNSAT;
+            }
+
+            uint32_t level = propagator.Analyze(learned);
+            for (Literal variable : propagator.Analyzed())
+                _brancher.Bump(variable);
+            _brancher.Decay();
+
+            propagator.Backtrack(level, unassigned);
+            _export(learned, propagator.Learn(learned));
+
+            continue;
+        }
+
+        if (conflicts >= next_restart)
+        {
+            propagator.Backtrack(0, unassigned);
+            next_restart = conflicts + _luby(++restarts) * restart_unit;
+
+            if (conflicts >= next_reduce)
+            {
+                propagator.ReduceLearned();
+                next_reduce = conflicts + reduce_interval + 300 * ++reductions;
+            }
+
+            dprintf("Restart %lu after %lu conflicts, %d learned clauses kept\n", restarts, conflicts, propagator.LearnedCount());
+
+            if (not _import(propagator))
+            {
+                _refuted = true;
+                return Status::UNSAT;
+            }
+            continue;
+        }
+
+        // Cube literals are decided first. Search decides only when all of them are true, and backjump
+        // undoing any of them undoes all later decisions, so false cube literal is implied by CNF and cube
+        Literal decision = EmptyLiteral;
+        for (uintptr_t idx = 0; idx < cube.size() and decision == EmptyLiteral; idx++)
+        {
+            int8_t value = propagator.Value(cube[idx]);
+            if (value == -1)
+                return Status::UNSAT;
+            if (value == 0)
+                decision = cube[idx];
+        }
+
+        if (decision == EmptyLiteral)
+            decision = _getLiteral(propagator);
+
+        if (decision == EmptyLiteral)
+        {
+            _saveModel(propagator);
+            return Status::SAT;
+        }
+
+        _complexity++;
+        propagator.NewDecisionLevel();
+        propagator.Assign(decision);
+    }
+}
+
+uint64_t Solver::_luby(uint64_t idx)
+{
+    uint64_t size = 1;
+    uint64_t power = 0;
+    while (size < idx + 1)
+    {
+        size = 2 * size + 1;
+        power++;
+    }
+
+    while (size - 1 != idx)
+    {
+        size = (size - 1) / 2;
+        power--;
+        idx = idx % size;
+    }
+
+    return 1ull << power;
+}
+
 Solver::Status Solver::Solve(CNF cnf)
 {
-    CNF::ActionResult res = CNF::ActionResult::OK;
-    if (_removeTrivial())
+    _model.clear();
+    _complexity = 0;
+    _stats = Statistics();
+
+    if (_preprocessing() and _preprocessor.Simplify(cnf) == CNF::ActionResult::EMPTY_CLAUSE_CREATED)
+        return Status::UNSAT;
+
+    if (_stopped())
+        return Status::UNKNOWN;
+
+    if (_removePure())
+        cnf.TrackPureLiterals();
+
+    CNF::ActionResult res = cnf.Check();
+    if (res == CNF::ActionResult::OK and _removeTrivial())
         res = cnf.RemoveTrivialClauses();
 
+    Status result = Status::UNKNOWN;
     switch (res)
     {
-        case CNF::ActionResult::CNF_DEVASTED: return Status::SAT; // If cnf was devasted, this branch is SAT
+        case CNF::ActionResult::CNF_DEVASTED: _saveModel(cnf); result = Status::SAT; break; // If cnf was devasted, this branch is SAT
         case CNF::ActionResult::EMPTY_CLAUSE_CREATED: return Status::UNSAT; // If empty clause was created, this branch is UNSAT
+        default: break;
     }
 
-    if (_recursiveSolving())
-        return _DPLLRecursive(cnf);
-    else
-        return _DPLLLinear(cnf);
+    if (result == Status::UNKNOWN)
+    {
+        _brancher.Init(cnf);
+
+        if (_conflictLearning())
+            result = _CDCL(cnf);
+        else if (_watchedLiterals())
+            result = _DPLLWatched(cnf);
+        else if (_recursiveSolving())
+            result = _DPLLRecursive(cnf);
+        else
+            result = _DPLLLinear(cnf);
+    }
+
+    // Propagator based engines count their own propagations, here only ones made on CNF are added
+    _stats.propagations += cnf.Propagations();
+
+    // Variables removed by preprocessing get values satisfying their original clauses
+    if (result == Status::SAT and _preprocessing())
+        _preprocessor.Extend(_model);
+
+    return result;
+}
+
+Solver::Status Solver::SolveCubes(CNF cnf, CubePool& pool, uint32_t worker)
+{
+    _pool = &pool;
+    _worker = worker;
+    _complexity = 0;
+    _stats = Statistics();
+    _refuted = false;
+    StopOn(pool.StopFlag());
+
+    Status result = Status::UNSAT;
+    std::vector<Literal> cube;
+
+    _brancher.Init(cnf);
+    Propagator propagator(cnf);
+
+    while (result == Status::UNSAT and pool.Pop(worker, cube))
+    {
+        dprintf("Worker %u took cube of %lu literals\n", worker, cube.size());
+        // After level 0 conflict propagator is not searched again, remaining cubes are just taken as refuted
+        if (_refuted)
+            continue;
+        result = _conflictLearning() ? _CDCL(propagator, cube) : _DPLLWatched(propagator, cube);
+    }
+
+    _stats.propagations = propagator.Propagations();
+
+    if (result == Status::SAT)
+        pool.Stop();
+
+    _pool = nullptr;
+    return result == Status::UNSAT and _stopped() ? Status::UNKNOWN : result;
 }
 
 uint64_t Solver::Complexity()
@@ -174,11 +636,51 @@ uint64_t Solver::Complexity()
     return _complexity;
 }
 
+const Solver::Statistics& Solver::Stats()
+{
+    return _stats;
+}
+
+std::string Solver::Branching()
+{
+    return _brancher.Name();
+}
+
+std::vector<Literal>& Solver::Model()
+{
+    return _model;
+}
+
+const Preprocessor::Statistics& Solver::PreprocessingStats()
+{
+    return _preprocessor.Stats();
+}
+
 bool Solver::_recursiveSolving()
 {
     return (_rules & Rule::RECURSIVE_SOLVING) == Rule::RECURSIVE_SOLVING;
 }
 
+bool Solver::_watchedLiterals()
+{
+    return (_rules & Rule::WATCHED_LITERALS) == Rule::WATCHED_LITERALS;
+}
+
+bool Solver::_conflictLearning()
+{
+    return (_rules & Rule::CONFLICT_LEARNING) == Rule::CONFLICT_LEARNING;
+}
+
+bool Solver::_phaseSaving()
+{
+    return (_rules & Rule::PHASE_SAVING) == Rule::PHASE_SAVING;
+}
+
+bool Solver::_preprocessing()
+{
+    return (_rules & Rule::PREPROCESSING) == Rule::PREPROCESSING;
+}
+
 bool Solver::_removeTrivial()
 {
     return (_rules & Rule::REMOVE_TRIVIAL) == Rule::REMOVE_TRIVIAL;
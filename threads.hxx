@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// Count of threads which can run at once, at least 1 even if it is unknown
+inline uint32_t AvailableThreads()
+{
+    uint32_t threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+/// Joining threads, every one of them decreases running when it is done.
+/// Workers already stop on flag of their parallel search, so caller's flag (if not null) is watched here and passed on by stop()
+template <class Callback>
+void JoinThreads(std::vector<std::thread>& threads, std::atomic<uint32_t>& running, const std::atomic<bool>* flag, Callback stop)
+{
+    bool stopped = false;
+    while (flag and running.load() > 0)
+    {
+        if (not stopped and flag->load(std::memory_order_relaxed))
+        {
+            stop();
+            stopped = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+}